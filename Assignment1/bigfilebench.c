@@ -0,0 +1,72 @@
+// bigfilebench: file system throughput for one big file.
+// Writes the largest file the file system allows, up to 2MB,
+// then reads it back, and reports KB/sec for each.
+// Compare builds with different block sizes, e.g.
+//   make clean; make qemu BSIZE=512   ...   make clean; make qemu BSIZE=4096
+// and run "bigfilebench" in each.
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "fcntl.h"
+#include "fs.h"
+
+#define HZ 100     // approximate timer ticks per second under qemu
+#define CHUNK 8192
+#define MAXSIZE (2*1024*1024)
+
+char buf[CHUNK];
+
+// Print throughput for kb kilobytes moved in ticks ticks.
+void
+report(char *what, uint kb, int ticks)
+{
+  if(ticks < 1)
+    ticks = 1;
+  printf(1, "bigfilebench: BSIZE %d %s %d KB in %d ticks, %d KB/sec\n",
+         BSIZE, what, kb, ticks, kb * HZ / ticks);
+}
+
+int
+main(int argc, char *argv[])
+{
+  int fd, i, n, start;
+  uint size, done;
+
+  size = MAXFILE*BSIZE;
+  if(size > MAXSIZE)
+    size = MAXSIZE;
+  size -= size % CHUNK;
+  for(i = 0; i < CHUNK; i++)
+    buf[i] = i;
+
+  unlink("bigfile.bench");
+  if((fd = open("bigfile.bench", O_CREATE|O_RDWR)) < 0){
+    printf(2, "bigfilebench: cannot create bigfile.bench\n");
+    exit(-1);
+  }
+  start = uptime();
+  for(done = 0; done < size; done += n){
+    if((n = write(fd, buf, CHUNK)) != CHUNK){
+      printf(2, "bigfilebench: write failed at %d\n", done);
+      exit(-1);
+    }
+  }
+  report("write", size/1024, uptime() - start);
+  close(fd);
+
+  if((fd = open("bigfile.bench", O_RDONLY)) < 0){
+    printf(2, "bigfilebench: cannot open bigfile.bench\n");
+    exit(-1);
+  }
+  start = uptime();
+  for(done = 0; (n = read(fd, buf, CHUNK)) > 0; done += n)
+    ;
+  report("read", done/1024, uptime() - start);
+  close(fd);
+  if(done != size)
+    printf(2, "bigfilebench: read %d bytes, wrote %d\n", done, size);
+
+  unlink("bigfile.bench");
+  exit(0);
+}
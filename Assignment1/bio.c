@@ -1,6 +1,6 @@
 // Buffer cache.
 //
-// The buffer cache is a linked list of buf structures holding
+// The buffer cache is a hash table of buf structures holding
 // cached copies of disk block contents.  Caching disk blocks
 // in memory reduces the number of disk reads and also provides
 // a synchronization point for disk blocks used by multiple processes.
@@ -17,6 +17,11 @@
 // * B_VALID: the buffer data has been read from the disk.
 // * B_DIRTY: the buffer data has been modified
 //     and needs to be written to disk.
+//
+// Each bucket of the table has its own lock, so lookups of
+// different blocks do not contend. A miss recycles the least
+// recently used free buffer from any bucket under bcache.lock,
+// which serializes moving buffers between buckets.
 
 #include "types.h"
 #include "defs.h"
@@ -26,70 +31,137 @@
 #include "fs.h"
 #include "buf.h"
 
+struct bucket {
+  struct spinlock lock;
+  struct buf head;    // circular list of buffers, through prev/next
+};
+
 struct {
   struct spinlock lock;
   struct buf buf[NBUF];
-
-  // Linked list of all buffers, through prev/next.
-  // head.next is most recently used.
-  struct buf head;
+  struct bucket bucket[NBUCKET];
 } bcache;
 
+static struct bucket*
+hash(uint dev, uint blockno)
+{
+  return &bcache.bucket[(dev * 7 + blockno) % NBUCKET];
+}
+
+static void
+blink(struct bucket *bk, struct buf *b)
+{
+  b->next = bk->head.next;
+  b->prev = &bk->head;
+  bk->head.next->prev = b;
+  bk->head.next = b;
+}
+
 void
 binit(void)
 {
+  struct bucket *bk;
   struct buf *b;
 
   initlock(&bcache.lock, "bcache");
 
 //PAGEBREAK!
-  // Create linked list of buffers
-  bcache.head.prev = &bcache.head;
-  bcache.head.next = &bcache.head;
+  // Create the bucket lists and spread the buffers over them
+  for(bk = bcache.bucket; bk < bcache.bucket+NBUCKET; bk++){
+    initlock(&bk->lock, "bcache.bucket");
+    bk->head.prev = &bk->head;
+    bk->head.next = &bk->head;
+  }
   for(b = bcache.buf; b < bcache.buf+NBUF; b++){
-    b->next = bcache.head.next;
-    b->prev = &bcache.head;
     initsleeplock(&b->lock, "buffer");
-    bcache.head.next->prev = b;
-    bcache.head.next = b;
+    blink(&bcache.bucket[(b - bcache.buf) % NBUCKET], b);
   }
 }
 
-// Look through buffer cache for block on device dev.
-// If not found, allocate a buffer.
-// In either case, return locked buffer.
+// Find block blockno on device dev in bucket bk and take a
+// reference to it. Caller must hold bk->lock.
 static struct buf*
-bget(uint dev, uint blockno)
+blookup(struct bucket *bk, uint dev, uint blockno)
 {
   struct buf *b;
 
-  acquire(&bcache.lock);
-
-  // Is the block already cached?
-  for(b = bcache.head.next; b != &bcache.head; b = b->next){
+  for(b = bk->head.next; b != &bk->head; b = b->next){
     if(b->dev == dev && b->blockno == blockno){
       b->refcnt++;
-      release(&bcache.lock);
-      acquiresleep(&b->lock);
       return b;
     }
   }
+  return 0;
+}
+
+// Look through buffer cache for block on device dev.
+// If not found, allocate a buffer.
+// In either case, return locked buffer.
+static struct buf*
+bget(uint dev, uint blockno)
+{
+  struct bucket *bk, *o, *vbk;
+  struct buf *b, *victim;
+
+  bk = hash(dev, blockno);
+  acquire(&bk->lock);
+  b = blookup(bk, dev, blockno);
+  release(&bk->lock);
+  if(b){
+    acquiresleep(&b->lock);
+    return b;
+  }
 
-  // Not cached; recycle some unused buffer and clean buffer
+  // Not cached. Every miss goes through bcache.lock, so look
+  // again under it before recycling a buffer.
+  acquire(&bcache.lock);
+  acquire(&bk->lock);
+  b = blookup(bk, dev, blockno);
+  release(&bk->lock);
+  if(b){
+    release(&bcache.lock);
+    acquiresleep(&b->lock);
+    return b;
+  }
+
+  // Recycle the least recently used unused and clean buffer.
   // "clean" because B_DIRTY and not locked means log.c
-  // hasn't yet committed the changes to the buffer.
-  for(b = bcache.head.prev; b != &bcache.head; b = b->prev){
-    if(b->refcnt == 0 && (b->flags & B_DIRTY) == 0) {
-      b->dev = dev;
-      b->blockno = blockno;
-      b->flags = 0;
-      b->refcnt = 1;
-      release(&bcache.lock);
-      acquiresleep(&b->lock);
-      return b;
+  // hasn't yet installed the changes to the buffer.
+  // The bucket of the best candidate so far stays locked;
+  // only misses, serialized by bcache.lock, hold two bucket locks.
+  victim = 0;
+  vbk = 0;
+  for(o = bcache.bucket; o < bcache.bucket+NBUCKET; o++){
+    acquire(&o->lock);
+    for(b = o->head.next; b != &o->head; b = b->next){
+      if(b->refcnt == 0 && (b->flags & B_DIRTY) == 0 &&
+         (victim == 0 || b->lastuse < victim->lastuse)){
+        victim = b;
+        if(vbk && vbk != o)
+          release(&vbk->lock);
+        vbk = o;
+      }
     }
+    if(vbk != o)
+      release(&o->lock);
   }
-  panic("bget: no buffers");
+  if(victim == 0)
+    panic("bget: no buffers");
+
+  // Off every list, victim cannot be found by anyone else.
+  victim->next->prev = victim->prev;
+  victim->prev->next = victim->next;
+  release(&vbk->lock);
+  victim->dev = dev;
+  victim->blockno = blockno;
+  victim->flags = 0;
+  victim->refcnt = 1;
+  acquire(&bk->lock);
+  blink(bk, victim);
+  release(&bk->lock);
+  release(&bcache.lock);
+  acquiresleep(&victim->lock);
+  return victim;
 }
 
 // Return a locked buf with the contents of the indicated block.
@@ -105,6 +177,22 @@ bread(uint dev, uint blockno)
   return b;
 }
 
+// Start reading the indicated block into the cache,
+// unless it is already there, without waiting for it.
+void
+breada(uint dev, uint blockno)
+{
+  struct buf *b;
+
+  b = bget(dev, blockno);
+  if(b->flags & B_VALID)
+    brelse(b);
+  else {
+    b->flags |= B_ASYNC;  // ideintr() releases b
+    idesubmit(b);
+  }
+}
+
 // Write b's contents to disk.  Must be locked.
 void
 bwrite(struct buf *b)
@@ -115,29 +203,45 @@ bwrite(struct buf *b)
   iderw(b);
 }
 
+// Start writing b's contents to disk without waiting, so that
+// writes of several buffers can be sorted and merged by ide.c.
+// Must be locked, and stay locked until bwrite_wait(b) returns.
+void
+bwrite_start(struct buf *b)
+{
+  if(!holdingsleep(&b->lock))
+    panic("bwrite_start");
+  b->flags |= B_DIRTY;
+  idesubmit(b);
+}
+
+// Wait for a write started by bwrite_start() to finish.
+void
+bwrite_wait(struct buf *b)
+{
+  ideawait(b);
+}
+
 // Release a locked buffer.
-// Move to the head of the MRU list.
+// Stamp it for LRU recycling if nobody else is using it.
 void
 brelse(struct buf *b)
 {
+  struct bucket *bk;
+
   if(!holdingsleep(&b->lock))
     panic("brelse");
 
   releasesleep(&b->lock);
 
-  acquire(&bcache.lock);
+  bk = hash(b->dev, b->blockno);
+  acquire(&bk->lock);
   b->refcnt--;
   if (b->refcnt == 0) {
     // no one is waiting for it.
-    b->next->prev = b->prev;
-    b->prev->next = b->next;
-    b->next = bcache.head.next;
-    b->prev = &bcache.head;
-    bcache.head.next->prev = b;
-    bcache.head.next = b;
+    b->lastuse = ticks;
   }
-  
-  release(&bcache.lock);
+  release(&bk->lock);
 }
 //PAGEBREAK!
 // Blank page.
@@ -0,0 +1,96 @@
+#include "types.h"
+#include "user.h"
+#include "perf.h"
+
+// Compensation ticket test: runs the same mix of CPU-bound and
+// I/O-bound children under UNIFORM and then under DYNAMIC, and
+// compares the average turnaround time of the I/O-bound ones.
+// With compensation tickets the I/O-bound children should finish
+// noticeably sooner under DYNAMIC.
+
+#define NCPUBOUND 10
+#define NIOBOUND 10
+#define NROUNDS 20
+#define CPUWORK 40000000  // loop iterations, about 40 ticks of CPU under qemu
+
+void
+cpuBound(void)
+{
+    int i;
+    volatile int x = 0;
+    for (i = 0; i < CPUWORK; i++)   // a fixed amount of work, not of time
+        x += i;
+    exit(0);
+}
+
+void
+ioBound(void)
+{
+    int i, j;
+    volatile int x = 0;
+    for (i = 0; i < NROUNDS; i++) {
+        for (j = 0; j < 1000; j++)      // short burst, well under a quantum
+            x += j;
+        sleep(1);
+    }
+    exit(0);
+}
+
+// Run the workload under policy pol; return the average
+// turnaround of the I/O-bound children.
+int
+run(int pol)
+{
+    int i, pid, iopids[NIOBOUND];
+    int sumIo = 0, sumCpu = 0;
+    struct perf perf;
+
+    policy(pol);
+    for (i = 0; i < NCPUBOUND; i++) {
+        if ((pid = fork()) < 0) {
+            printf(2, "comptest: fork failed\n");
+            exit(-1);
+        }
+        if (pid == 0)
+            cpuBound();
+    }
+    for (i = 0; i < NIOBOUND; i++) {
+        if ((iopids[i] = fork()) < 0) {
+            printf(2, "comptest: fork failed\n");
+            exit(-1);
+        }
+        if (iopids[i] == 0)
+            ioBound();
+    }
+
+    for (i = 0; i < NCPUBOUND + NIOBOUND; i++) {
+        int j, isIo = 0;
+        pid = wait_stat(0, &perf);
+        for (j = 0; j < NIOBOUND; j++)
+            if (iopids[j] == pid)
+                isIo = 1;
+        if (isIo)
+            sumIo += perf.ttime - perf.ctime;
+        else
+            sumCpu += perf.ttime - perf.ctime;
+    }
+    printf(1, "policy %d: I/O-bound turnaround %d, CPU-bound turnaround %d\n",
+           pol, sumIo / NIOBOUND, sumCpu / NCPUBOUND);
+    return sumIo / NIOBOUND;
+}
+
+int
+main(void)
+{
+    int uniform, dynamic;
+
+    uniform = run(1);
+    dynamic = run(3);
+    if (dynamic < uniform)
+        printf(1, "comptest: DYNAMIC cut I/O-bound turnaround by %d ticks (%d%%)\n",
+               uniform - dynamic, (uniform - dynamic) * 100 / uniform);
+    else
+        printf(1, "comptest: no turnaround gain under DYNAMIC\n");
+    policy(1);
+    exit(0);
+}
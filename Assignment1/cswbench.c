@@ -0,0 +1,85 @@
+// Context switch benchmark for the per-CPU run queues.
+// Runs npairs of processes that bounce a byte over a pair of pipes
+// for a fixed number of ticks. Every hop blocks the sender and wakes
+// the receiver, so each hop is one sleep/wakeup/schedule cycle.
+// Compare the reported rate across runs with different CPUS, e.g.
+//   make qemu CPUS=1   ...   make qemu CPUS=8
+// and run "cswbench 8 500" in each.
+
+#include "types.h"
+#include "user.h"
+
+#define HZ 100   // approximate timer ticks per second under qemu
+
+// Bounce a byte until deadline; return the number of hops made.
+int
+pingpong(int rfd, int wfd, int first, int deadline)
+{
+  char c;
+  int n;
+
+  n = 0;
+  c = 0;
+  if(first && write(wfd, &c, 1) != 1)
+    return -1;
+  while(uptime() < deadline){
+    if(read(rfd, &c, 1) != 1)
+      break;
+    n++;
+    if(write(wfd, &c, 1) != 1)
+      break;
+  }
+  return n;
+}
+
+int
+main(int argc, char *argv[])
+{
+  int npairs, nticks, start, deadline, i, status, hops, elapsed;
+  int ab[2], ba[2];
+
+  npairs = argc > 1 ? atoi(argv[1]) : 4;
+  nticks = argc > 2 ? atoi(argv[2]) : 300;
+  if(npairs < 1 || nticks < 1){
+    printf(2, "usage: cswbench [npairs] [ticks]\n");
+    exit(-1);
+  }
+
+  start = uptime();
+  deadline = start + nticks;
+  for(i = 0; i < npairs; i++){
+    if(pipe(ab) < 0 || pipe(ba) < 0){
+      printf(2, "cswbench: pipe failed\n");
+      exit(-1);
+    }
+    if(fork() == 0){
+      close(ab[1]);
+      close(ba[0]);
+      exit(pingpong(ab[0], ba[1], 1, deadline));
+    }
+    if(fork() == 0){
+      close(ab[0]);
+      close(ba[1]);
+      exit(pingpong(ba[0], ab[1], 0, deadline));
+    }
+    close(ab[0]);
+    close(ab[1]);
+    close(ba[0]);
+    close(ba[1]);
+  }
+
+  hops = 0;
+  for(i = 0; i < 2*npairs; i++){
+    if(wait(&status) < 0)
+      break;
+    if(status > 0)
+      hops += status;
+  }
+  elapsed = uptime() - start;
+  if(elapsed < 1)
+    elapsed = 1;
+
+  printf(1, "cswbench: %d pairs, %d ticks, %d switches, %d switches/sec\n",
+         npairs, elapsed, hops, hops * HZ / elapsed);
+  exit(0);
+}
@@ -2,6 +2,7 @@ struct buf;
 struct context;
 struct file;
 struct inode;
+struct kmem_cache;
 struct pipe;
 struct proc;
 struct rtcdate;
@@ -10,11 +11,15 @@ struct sleeplock;
 struct stat;
 struct superblock;
 struct perf;
+struct tperf;
 // bio.c
 void            binit(void);
+void            breada(uint, uint);
 struct buf*     bread(uint, uint);
 void            brelse(struct buf*);
 void            bwrite(struct buf*);
+void            bwrite_start(struct buf*);
+void            bwrite_wait(struct buf*);
 
 // console.c
 void            consoleinit(void);
@@ -38,8 +43,10 @@ int             filewrite(struct file*, char*, int n);
 void            readsb(int dev, struct superblock *sb);
 int             dirlink(struct inode*, char*, uint);
 struct inode*   dirlookup(struct inode*, char*, uint*);
+void            dirunlink(struct inode*, char*, uint);
 struct inode*   ialloc(uint, short);
 struct inode*   idup(struct inode*);
+void            icacheinit(void);
 void            iinit(int dev);
 void            ilock(struct inode*);
 void            iput(struct inode*);
@@ -57,6 +64,9 @@ int             writei(struct inode*, char*, uint, uint);
 void            ideinit(void);
 void            ideintr(void);
 void            iderw(struct buf*);
+void            ideawait(struct buf*);
+void            idesubmit(struct buf*);
+int             idewrites(void);
 
 // ioapic.c
 void            ioapicenable(int irq, int cpu);
@@ -65,9 +75,14 @@ void            ioapicinit(void);
 
 // kalloc.c
 char*           kalloc(void);
+char*           kalloc_zeroed(void);
 void            kfree(char*);
+int             kfreepages(void);
 void            kinit1(void*, void*);
 void            kinit2(void*, void*);
+int             krefcount(char*);
+void            krefinc(char*);
+void            kzeroidle(void);
 
 // kbd.c
 void            kbdintr(void);
@@ -79,6 +94,9 @@ extern volatile uint*    lapic;
 void            lapiceoi(void);
 void            lapicinit(void);
 void            lapicstartap(uchar, uint);
+uint            lapictimer(void);
+void            tscinit(void);
+uint            tsc2us(uint64);
 void            microdelay(int);
 
 // log.c
@@ -86,6 +104,7 @@ void            initlog(int dev);
 void            log_write(struct buf*);
 void            begin_op();
 void            end_op();
+void            log_sync(void);
 
 // mp.c
 extern int      ismp;
@@ -98,6 +117,7 @@ void            picinit(void);
 // pipe.c
 int             pipealloc(struct file**, struct file**);
 void            pipeclose(struct pipe*, int);
+void            pipeinit(void);
 int             piperead(struct pipe*, char*, int);
 int             pipewrite(struct pipe*, char*, int);
 
@@ -116,14 +136,24 @@ void            userinit(void);
 int             wait(int*);
 void            wakeup(void*);
 void            yield(void);
-void			update_performance(void);
 void		    priority(int);
 void 		    policy(int);
 int 		    wait_stat(int* status ,struct perf *);
+int 		    wait_tstat(int* status ,struct tperf *);
+int             setaffinity(int, uint);
+
+// schedtrace.c
+int             schedtrace(struct proc*, int, int, uint, uint);
+void            schedtraceinit(void);
 
 // swtch.S
 void            swtch(struct context**, struct context*);
 
+// slab.c
+void*           kmem_cache_alloc(struct kmem_cache*);
+struct kmem_cache* kmem_cache_create(char*, uint);
+void            kmem_cache_free(struct kmem_cache*, void*);
+
 // spinlock.c
 void            acquire(struct spinlock*);
 void            getcallerpcs(void*, uint*);
@@ -181,6 +211,10 @@ void            freevm(pde_t*);
 void            inituvm(pde_t*, char*, uint);
 int             loaduvm(pde_t*, char*, struct inode*, uint, uint);
 pde_t*          copyuvm(pde_t*, uint);
+int             cowfault(pde_t*, uint);
+int             lazyfault(pde_t*, uint);
+int             uvmpopulate(pde_t*, uint, uint);
+int             uvmwritable(pde_t*, uint, uint);
 void            switchuvm(struct proc*);
 void            switchkvm(void);
 int             copyout(pde_t*, uint, void*, uint);
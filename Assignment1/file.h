@@ -14,15 +14,22 @@ struct inode {
   uint dev;           // Device number
   uint inum;          // Inode number
   int ref;            // Reference count
+  struct inode *next; // icache hash bucket list
+  uint lastuse;       // ticks when ref last dropped to 0
   struct sleeplock lock;
   int flags;          // I_VALID
+  uint ranext;        // block a sequential readi() would read next
+  uint raend;         // blocks before this have been read ahead
+  uint lastalloc;     // data block bmap() allocated last
+  uint prealloc;      // extent writei() allocated for bmap() to use
+  uint nprealloc;
 
   short type;         // copy of disk inode
   short major;
   short minor;
   short nlink;
   uint size;
-  uint addrs[NDIRECT+1];
+  uint addrs[NDIRECT+2];
 };
 #define I_VALID 0x2
 
@@ -36,6 +43,7 @@ struct devsw {
 extern struct devsw devsw[];
 
 #define CONSOLE 1
+#define SCHEDTRACE 2
 
 //PAGEBREAK!
 // Blank page.
@@ -23,6 +23,8 @@
 
 #define min(a, b) ((a) < (b) ? (a) : (b))
 static void itrunc(struct inode*);
+static void dcacheinit(void);
+static void dpurge(struct inode*);
 // there should be one superblock per disk device, but we run with
 // only one device
 struct superblock sb; 
@@ -52,31 +54,105 @@ bzero(int dev, int bno)
 
 // Blocks.
 
-// Allocate a zeroed disk block.
+// Allocator state for the one file system: a next-fit cursor,
+// so allocation does not rescan the bitmap from block 0 each time,
+// and the number of free blocks under each bitmap block (-1 until
+// that bitmap block is first read), so scans skip full ones.
+static struct {
+  struct spinlock lock;
+  uint cursor;
+  int nfree[FSSIZE/BPB + 1];
+} bstate;
+
+static void
+bstateinit(void)
+{
+  int i;
+
+  if((sb.size + BPB - 1) / BPB > NELEM(bstate.nfree))
+    panic("bstateinit: file system too big");
+  initlock(&bstate.lock, "bstate");
+  bstate.cursor = sb.size - sb.nblocks;  // first data block
+  for(i = 0; i < NELEM(bstate.nfree); i++)
+    bstate.nfree[i] = -1;
+}
+
+// Allocate up to want contiguous zeroed disk blocks, at the
+// first free block from goal on, or from the cursor if goal is 0.
+// Sets *n to the number allocated, at least 1, and returns the
+// first block. The blocks come from a single bitmap
+// block, so marking them costs one log write.
 static uint
-balloc(uint dev)
+ballocn(uint dev, uint goal, uint want, uint *n)
 {
-  int b, bi, m;
+  int b, bi, ei, m, i, k, nbmap, nfree;
   struct buf *bp;
 
-  bp = 0;
-  for(b = 0; b < sb.size; b += BPB){
+  nbmap = (sb.size + BPB - 1) / BPB;
+  if(goal == 0 || goal >= sb.size){
+    acquire(&bstate.lock);
+    goal = bstate.cursor;
+    release(&bstate.lock);
+  }
+
+  // Visit the bitmap blocks from goal's on, wrapping around,
+  // and goal's again for the blocks before goal.
+  for(k = 0; k <= nbmap; k++){
+    b = ((goal / BPB + k) % nbmap) * BPB;
+    acquire(&bstate.lock);
+    nfree = bstate.nfree[b / BPB];
+    release(&bstate.lock);
+    if(nfree == 0)
+      continue;
+
     bp = bread(dev, BBLOCK(b, sb));
-    for(bi = 0; bi < BPB && b + bi < sb.size; bi++){
+    acquire(&bstate.lock);  // now stable, as we hold the bitmap block
+    nfree = bstate.nfree[b / BPB];
+    release(&bstate.lock);
+    if(nfree < 0){
+      nfree = 0;
+      for(bi = 0; bi < BPB && b + bi < sb.size; bi++)
+        if((bp->data[bi/8] & (1 << (bi % 8))) == 0)
+          nfree++;
+    }
+    for(bi = k == 0 ? goal % BPB : 0; bi < BPB && b + bi < sb.size; bi++){
       m = 1 << (bi % 8);
       if((bp->data[bi/8] & m) == 0){  // Is block free?
-        bp->data[bi/8] |= m;  // Mark block in use.
+        for(ei = bi; ei < BPB && b + ei < sb.size && ei - bi < want; ei++){
+          m = 1 << (ei % 8);
+          if(bp->data[ei/8] & m)
+            break;
+          bp->data[ei/8] |= m;  // Mark block in use.
+        }
         log_write(bp);
+        acquire(&bstate.lock);
+        bstate.nfree[b / BPB] = nfree - (ei - bi);
+        bstate.cursor = b + ei;
+        release(&bstate.lock);
         brelse(bp);
-        bzero(dev, b + bi);
+        for(i = bi; i < ei; i++)
+          bzero(dev, b + i);
+        *n = ei - bi;
         return b + bi;
       }
     }
+    acquire(&bstate.lock);
+    bstate.nfree[b / BPB] = nfree;
+    release(&bstate.lock);
     brelse(bp);
   }
   panic("balloc: out of blocks");
 }
 
+// Allocate a zeroed disk block.
+static uint
+balloc(uint dev)
+{
+  uint n;
+
+  return ballocn(dev, 0, 1, &n);
+}
+
 // Free a disk block.
 static void
 bfree(int dev, uint b)
@@ -92,6 +168,10 @@ bfree(int dev, uint b)
     panic("freeing free block");
   bp->data[bi/8] &= ~m;
   log_write(bp);
+  acquire(&bstate.lock);
+  if(bstate.nfree[b / BPB] >= 0)
+    bstate.nfree[b / BPB]++;
+  release(&bstate.lock);
   brelse(bp);
 }
 
@@ -121,17 +201,19 @@ bfree(int dev, uint b)
 //   the link count has fallen to zero.
 //
 // * Referencing in cache: an entry in the inode cache
-//   is free if ip->ref is zero. Otherwise ip->ref tracks
-//   the number of in-memory pointers to the entry (open
-//   files and current directories). iget() to find or
-//   create a cache entry and increment its ref, iput()
-//   to decrement ref.
+//   may be reused for another inode if ip->ref is zero.
+//   Otherwise ip->ref tracks the number of in-memory
+//   pointers to the entry (open files and current
+//   directories). iget() to find or create a cache entry
+//   and increment its ref, iput() to decrement ref.
 //
 // * Valid: the information (type, size, &c) in an inode
 //   cache entry is only correct when the I_VALID bit
 //   is set in ip->flags. ilock() reads the inode from
-//   the disk and sets I_VALID, while iput() clears
-//   I_VALID if ip->ref has fallen to zero.
+//   the disk and sets I_VALID. It stays set when ip->ref
+//   falls to zero, so a later iget() and ilock() of the
+//   same inode need no disk read, until iput() frees the
+//   inode on disk or iget() reuses the entry.
 //
 // * Locked: file system code may only examine and modify
 //   the information in an inode and its content if it
@@ -155,26 +237,54 @@ bfree(int dev, uint b)
 // have locked the inodes involved; this lets callers create
 // multi-step atomic operations.
 
+// The cache is a hash table. Each bucket has its own lock,
+// which also protects the ref of the inodes in it, so lookups
+// of different inodes do not contend. Entries come from a slab
+// cache until there are NINODE of them; after that a miss
+// reuses the least recently used entry with ref zero, under
+// icache.lock, which serializes moving entries between buckets.
+
+struct ibucket {
+  struct spinlock lock;
+  struct inode *head;
+};
+
 struct {
   struct spinlock lock;
-  struct inode inode[NINODE];
+  struct kmem_cache *cache;
+  int ninode;           // entries allocated, at most NINODE
+  struct ibucket bucket[NIBUCKET];
 } icache;
 
+// Called by main() at boot; userinit() already looks up "/",
+// long before the first process calls iinit().
 void
-iinit(int dev)
+icacheinit(void)
 {
-  int i = 0;
-  
+  struct ibucket *bk;
+
   initlock(&icache.lock, "icache");
-  for(i = 0; i < NINODE; i++) {
-    initsleeplock(&icache.inode[i].lock, "inode");
-  }
-  
+  icache.cache = kmem_cache_create("inode", sizeof(struct inode));
+  for(bk = icache.bucket; bk < icache.bucket+NIBUCKET; bk++)
+    initlock(&bk->lock, "icache.bucket");
+  dcacheinit();
+}
+
+static struct ibucket*
+ihash(uint dev, uint inum)
+{
+  return &icache.bucket[(dev * 7 + inum) % NIBUCKET];
+}
+
+void
+iinit(int dev)
+{
   readsb(dev, &sb);
   cprintf("sb: size %d nblocks %d ninodes %d nlog %d logstart %d\
  inodestart %d bmap start %d\n", sb.size, sb.nblocks,
           sb.ninodes, sb.nlog, sb.logstart, sb.inodestart,
           sb.bmapstart);
+  bstateinit();
 }
 
 static struct inode* iget(uint dev, uint inum);
@@ -223,40 +333,96 @@ iupdate(struct inode *ip)
   brelse(bp);
 }
 
+// Find inode inum on device dev in bucket bk and take a
+// reference to it. Caller must hold bk->lock.
+static struct inode*
+ilookup(struct ibucket *bk, uint dev, uint inum)
+{
+  struct inode *ip;
+
+  for(ip = bk->head; ip; ip = ip->next){
+    if(ip->dev == dev && ip->inum == inum){
+      ip->ref++;
+      return ip;
+    }
+  }
+  return 0;
+}
+
 // Find the inode with number inum on device dev
 // and return the in-memory copy. Does not lock
 // the inode and does not read it from disk.
 static struct inode*
 iget(uint dev, uint inum)
 {
-  struct inode *ip, *empty;
-
+  struct ibucket *bk, *o, *vbk;
+  struct inode *ip, *victim, **pp;
+
+  bk = ihash(dev, inum);
+  acquire(&bk->lock);
+  ip = ilookup(bk, dev, inum);
+  release(&bk->lock);
+  if(ip)
+    return ip;
+
+  // Not cached. Every miss goes through icache.lock, so look
+  // again under it before taking an entry.
   acquire(&icache.lock);
+  acquire(&bk->lock);
+  ip = ilookup(bk, dev, inum);
+  release(&bk->lock);
+  if(ip){
+    release(&icache.lock);
+    return ip;
+  }
 
-  // Is the inode already cached?
-  empty = 0;
-  for(ip = &icache.inode[0]; ip < &icache.inode[NINODE]; ip++){
-    if(ip->ref > 0 && ip->dev == dev && ip->inum == inum){
-      ip->ref++;
-      release(&icache.lock);
-      return ip;
+  if(icache.ninode < NINODE && (victim = kmem_cache_alloc(icache.cache)) != 0){
+    initsleeplock(&victim->lock, "inode");
+    icache.ninode++;
+  } else {
+    // Reuse the least recently used entry with ref zero.
+    // The bucket of the best candidate so far stays locked;
+    // only misses, serialized by icache.lock, hold two bucket locks.
+    victim = 0;
+    vbk = 0;
+    for(o = icache.bucket; o < icache.bucket+NIBUCKET; o++){
+      acquire(&o->lock);
+      for(ip = o->head; ip; ip = ip->next){
+        if(ip->ref == 0 && (victim == 0 || ip->lastuse < victim->lastuse)){
+          victim = ip;
+          if(vbk && vbk != o)
+            release(&vbk->lock);
+          vbk = o;
+        }
+      }
+      if(vbk != o)
+        release(&o->lock);
     }
-    if(empty == 0 && ip->ref == 0)    // Remember empty slot.
-      empty = ip;
+    if(victim == 0)
+      panic("iget: no inodes");
+
+    // Off every list, victim cannot be found by anyone else.
+    for(pp = &vbk->head; *pp != victim; pp = &(*pp)->next)
+      ;
+    *pp = victim->next;
+    release(&vbk->lock);
   }
 
-  // Recycle an inode cache entry.
-  if(empty == 0)
-    panic("iget: no inodes");
-
-  ip = empty;
-  ip->dev = dev;
-  ip->inum = inum;
-  ip->ref = 1;
-  ip->flags = 0;
+  victim->dev = dev;
+  victim->inum = inum;
+  victim->ref = 1;
+  victim->flags = 0;
+  victim->ranext = 0;
+  victim->raend = 0;
+  victim->lastalloc = 0;
+  victim->nprealloc = 0;
+  acquire(&bk->lock);
+  victim->next = bk->head;
+  bk->head = victim;
+  release(&bk->lock);
   release(&icache.lock);
 
-  return ip;
+  return victim;
 }
 
 // Increment reference count for ip.
@@ -264,9 +430,12 @@ iget(uint dev, uint inum)
 struct inode*
 idup(struct inode *ip)
 {
-  acquire(&icache.lock);
+  struct ibucket *bk;
+
+  bk = ihash(ip->dev, ip->inum);
+  acquire(&bk->lock);
   ip->ref++;
-  release(&icache.lock);
+  release(&bk->lock);
   return ip;
 }
 
@@ -310,8 +479,8 @@ iunlock(struct inode *ip)
 }
 
 // Drop a reference to an in-memory inode.
-// If that was the last reference, the inode cache entry can
-// be recycled.
+// If that was the last reference, the inode cache entry
+// may be reused, but stays valid until then.
 // If that was the last reference and the inode has no links
 // to it, free the inode (and its content) on disk.
 // All calls to iput() must be inside a transaction in
@@ -319,18 +488,24 @@ iunlock(struct inode *ip)
 void
 iput(struct inode *ip)
 {
-  acquire(&icache.lock);
+  struct ibucket *bk;
+
+  bk = ihash(ip->dev, ip->inum);
+  acquire(&bk->lock);
   if(ip->ref == 1 && (ip->flags & I_VALID) && ip->nlink == 0){
     // inode has no links and no other references: truncate and free.
-    release(&icache.lock);
+    release(&bk->lock);
+    if(ip->type == T_DIR)
+      dpurge(ip);
     itrunc(ip);
     ip->type = 0;
     iupdate(ip);
-    acquire(&icache.lock);
+    acquire(&bk->lock);
     ip->flags = 0;
   }
-  ip->ref--;
-  release(&icache.lock);
+  if(--ip->ref == 0)
+    ip->lastuse = ticks;
+  release(&bk->lock);
 }
 
 // Common idiom: unlock, then put.
@@ -347,7 +522,32 @@ iunlockput(struct inode *ip)
 // The content (data) associated with each inode is stored
 // in blocks on the disk. The first NDIRECT block numbers
 // are listed in ip->addrs[].  The next NINDIRECT blocks are
-// listed in block ip->addrs[NDIRECT].
+// listed in block ip->addrs[NDIRECT].  The last NDINDIRECT
+// blocks are listed in the blocks listed in the double
+// indirect block ip->addrs[NDIRECT+1].
+
+// Where ip's next data block should go: right after its last
+// one, so that a file written sequentially stays contiguous.
+static uint
+bgoal(struct inode *ip)
+{
+  return ip->lastalloc ? ip->lastalloc + 1 : 0;
+}
+
+// Allocate a data block for ip, from the extent writei()
+// set aside if there is one.
+static uint
+bdata(struct inode *ip)
+{
+  uint n;
+
+  if(ip->nprealloc > 0){
+    ip->nprealloc--;
+    ip->lastalloc = ip->prealloc++;
+  } else
+    ip->lastalloc = ballocn(ip->dev, bgoal(ip), 1, &n);
+  return ip->lastalloc;
+}
 
 // Return the disk block address of the nth block in inode ip.
 // If there is no such block, bmap allocates one.
@@ -359,7 +559,7 @@ bmap(struct inode *ip, uint bn)
 
   if(bn < NDIRECT){
     if((addr = ip->addrs[bn]) == 0)
-      ip->addrs[bn] = addr = balloc(ip->dev);
+      ip->addrs[bn] = addr = bdata(ip);
     return addr;
   }
   bn -= NDIRECT;
@@ -371,7 +571,30 @@ bmap(struct inode *ip, uint bn)
     bp = bread(ip->dev, addr);
     a = (uint*)bp->data;
     if((addr = a[bn]) == 0){
-      a[bn] = addr = balloc(ip->dev);
+      a[bn] = addr = bdata(ip);
+      log_write(bp);
+    }
+    brelse(bp);
+    return addr;
+  }
+  bn -= NINDIRECT;
+
+  if(bn < NDINDIRECT){
+    // Load double indirect block, then the indirect block
+    // it points to, allocating either if necessary.
+    if((addr = ip->addrs[NDIRECT+1]) == 0)
+      ip->addrs[NDIRECT+1] = addr = balloc(ip->dev);
+    bp = bread(ip->dev, addr);
+    a = (uint*)bp->data;
+    if((addr = a[bn / NINDIRECT]) == 0){
+      a[bn / NINDIRECT] = addr = balloc(ip->dev);
+      log_write(bp);
+    }
+    brelse(bp);
+    bp = bread(ip->dev, addr);
+    a = (uint*)bp->data;
+    if((addr = a[bn % NINDIRECT]) == 0){
+      a[bn % NINDIRECT] = addr = bdata(ip);
       log_write(bp);
     }
     brelse(bp);
@@ -389,9 +612,9 @@ bmap(struct inode *ip, uint bn)
 static void
 itrunc(struct inode *ip)
 {
-  int i, j;
-  struct buf *bp;
-  uint *a;
+  int i, j, k;
+  struct buf *bp, *bp2;
+  uint *a, *a2;
 
   for(i = 0; i < NDIRECT; i++){
     if(ip->addrs[i]){
@@ -412,7 +635,28 @@ itrunc(struct inode *ip)
     ip->addrs[NDIRECT] = 0;
   }
 
+  if(ip->addrs[NDIRECT+1]){
+    bp = bread(ip->dev, ip->addrs[NDIRECT+1]);
+    a = (uint*)bp->data;
+    for(j = 0; j < NINDIRECT; j++){
+      if(a[j] == 0)
+        continue;
+      bp2 = bread(ip->dev, a[j]);
+      a2 = (uint*)bp2->data;
+      for(k = 0; k < NINDIRECT; k++){
+        if(a2[k])
+          bfree(ip->dev, a2[k]);
+      }
+      brelse(bp2);
+      bfree(ip->dev, a[j]);
+    }
+    brelse(bp);
+    bfree(ip->dev, ip->addrs[NDIRECT+1]);
+    ip->addrs[NDIRECT+1] = 0;
+  }
+
   ip->size = 0;
+  ip->lastalloc = 0;
   iupdate(ip);
 }
 
@@ -427,6 +671,36 @@ stati(struct inode *ip, struct stat *st)
   st->size = ip->size;
 }
 
+#define NREADAHEAD 8  // blocks read ahead of a sequential reader
+
+// Called by readi() after a read of ip from block bn up to
+// byte end. If it continued where the previous read stopped,
+// start reading the next NREADAHEAD blocks into the buffer
+// cache, so the disk works while the reader computes.
+// Caller must hold ip->lock.
+static void
+readahead(struct inode *ip, uint bn, uint end)
+{
+  uint b, last;
+
+  if(bn != ip->ranext){
+    ip->ranext = end/BSIZE;
+    ip->raend = 0;
+    return;
+  }
+  ip->ranext = end/BSIZE;
+  b = (end + BSIZE - 1)/BSIZE;
+  if(b < ip->raend)
+    b = ip->raend;
+  last = (ip->size + BSIZE - 1)/BSIZE;
+  if(last > (end + BSIZE - 1)/BSIZE + NREADAHEAD)
+    last = (end + BSIZE - 1)/BSIZE + NREADAHEAD;
+  for(; b < last; b++)
+    breada(ip->dev, bmap(ip, b));
+  if(last > ip->raend)
+    ip->raend = last;
+}
+
 //PAGEBREAK!
 // Read data from inode.
 int
@@ -459,6 +733,7 @@ readi(struct inode *ip, char *dst, uint off, uint n)
     memmove(dst, bp->data + off%BSIZE, m);
     brelse(bp);
   }
+  readahead(ip, (off - n)/BSIZE, off);
   return n;
 }
 
@@ -467,7 +742,7 @@ readi(struct inode *ip, char *dst, uint off, uint n)
 int
 writei(struct inode *ip, char *src, uint off, uint n)
 {
-  uint tot, m;
+  uint tot, m, first, last;
   struct buf *bp;
 
   if(ip->type == T_DEV){
@@ -481,6 +756,13 @@ writei(struct inode *ip, char *src, uint off, uint n)
   if(off + n > MAXFILE*BSIZE)
     return -1;
 
+  // Files have no holes, so the blocks from first to last are
+  // new; allocate them as one extent.
+  first = (ip->size + BSIZE - 1) / BSIZE;
+  last = (off + n + BSIZE - 1) / BSIZE;
+  if(last > first)
+    ip->prealloc = ballocn(ip->dev, bgoal(ip), last - first, &ip->nprealloc);
+
   for(tot=0; tot<n; tot+=m, off+=m, src+=m){
     bp = bread(ip->dev, bmap(ip, off/BSIZE));
     m = min(n - tot, BSIZE - off%BSIZE);
@@ -505,6 +787,133 @@ namecmp(const char *s, const char *t)
   return strncmp(s, t, DIRSIZ);
 }
 
+// Directory name cache. Each entry maps a directory and a
+// name in it to the name's inode number and the offset of its
+// dirent, or records that the name is absent (inum 0), so that
+// repeated lookups of the same path need not read directories.
+// Entries for a directory are only made and changed with the
+// directory locked, by dirlookup(), dirlink() and dirunlink(),
+// so they always match its contents. Entries are replaced in
+// FIFO order when the cache is full.
+
+#define NDHASH 61  // hash buckets in the name cache
+
+struct dentry {
+  uint dev;
+  uint dinum;           // directory; 0 if the entry is unused
+  char name[DIRSIZ];
+  uint inum;            // 0 if name is not in the directory
+  uint off;             // byte offset of name's dirent
+  struct dentry *next;  // hash bucket list
+};
+
+static struct {
+  struct spinlock lock;
+  struct dentry ent[NDENTRY];
+  struct dentry *bucket[NDHASH];
+  int hand;             // next entry to replace
+} dcache;
+
+static void
+dcacheinit(void)
+{
+  initlock(&dcache.lock, "dcache");
+}
+
+static struct dentry**
+dhash(uint dev, uint dinum, char *name)
+{
+  uint h;
+  int i;
+
+  h = dev * 7 + dinum;
+  for(i = 0; i < DIRSIZ && name[i]; i++)
+    h = h * 31 + name[i];
+  return &dcache.bucket[h % NDHASH];
+}
+
+// Find the entry for name in directory dp, and return the
+// link that points to it. Caller must hold dcache.lock.
+static struct dentry**
+dfind(struct inode *dp, char *name)
+{
+  struct dentry **pp;
+
+  for(pp = dhash(dp->dev, dp->inum, name); *pp; pp = &(*pp)->next){
+    if((*pp)->dev == dp->dev && (*pp)->dinum == dp->inum &&
+       namecmp((*pp)->name, name) == 0)
+      break;
+  }
+  return pp;
+}
+
+// Remove entry d from its hash bucket. Caller must hold dcache.lock.
+static void
+dunlink(struct dentry *d)
+{
+  struct dentry **pp;
+
+  for(pp = dhash(d->dev, d->dinum, d->name); *pp != d; pp = &(*pp)->next)
+    ;
+  *pp = d->next;
+  d->dinum = 0;
+}
+
+// Look up name in directory dp in the cache. If it is there,
+// set *inum and *off and return 1.
+static int
+dget(struct inode *dp, char *name, uint *inum, uint *off)
+{
+  struct dentry *d;
+
+  acquire(&dcache.lock);
+  if((d = *dfind(dp, name)) != 0){
+    *inum = d->inum;
+    *off = d->off;
+  }
+  release(&dcache.lock);
+  return d != 0;
+}
+
+// Record that name in directory dp is inode inum, with its
+// dirent at off, or that it is absent if inum is 0.
+static void
+dput(struct inode *dp, char *name, uint inum, uint off)
+{
+  struct dentry **pp, *d;
+
+  acquire(&dcache.lock);
+  if((d = *dfind(dp, name)) == 0){
+    d = &dcache.ent[dcache.hand];
+    dcache.hand = (dcache.hand + 1) % NDENTRY;
+    if(d->dinum)
+      dunlink(d);
+    d->dev = dp->dev;
+    d->dinum = dp->inum;
+    strncpy(d->name, name, DIRSIZ);
+    pp = dhash(d->dev, d->dinum, d->name);
+    d->next = *pp;
+    *pp = d;
+  }
+  d->inum = inum;
+  d->off = off;
+  release(&dcache.lock);
+}
+
+// Forget all entries for directory dp, which is being freed.
+static void
+dpurge(struct inode *dp)
+{
+  struct dentry *d;
+
+  acquire(&dcache.lock);
+  for(d = dcache.ent; d < dcache.ent+NDENTRY; d++){
+    if(d->dinum == dp->inum && d->dev == dp->dev)
+      dunlink(d);
+  }
+  release(&dcache.lock);
+}
+
 // Look for a directory entry in a directory.
 // If found, set *poff to byte offset of entry.
 struct inode*
@@ -516,6 +925,14 @@ dirlookup(struct inode *dp, char *name, uint *poff)
   if(dp->type != T_DIR)
     panic("dirlookup not DIR");
 
+  if(dget(dp, name, &inum, &off)){
+    if(inum == 0)
+      return 0;
+    if(poff)
+      *poff = off;
+    return iget(dp->dev, inum);
+  }
+
   for(off = 0; off < dp->size; off += sizeof(de)){
     if(readi(dp, (char*)&de, off, sizeof(de)) != sizeof(de))
       panic("dirlink read");
@@ -526,10 +943,12 @@ dirlookup(struct inode *dp, char *name, uint *poff)
       if(poff)
         *poff = off;
       inum = de.inum;
+      dput(dp, name, inum, off);
       return iget(dp->dev, inum);
     }
   }
 
+  dput(dp, name, 0, 0);
   return 0;
 }
 
@@ -559,10 +978,24 @@ dirlink(struct inode *dp, char *name, uint inum)
   de.inum = inum;
   if(writei(dp, (char*)&de, off, sizeof(de)) != sizeof(de))
     panic("dirlink");
+  dput(dp, name, inum, off);
 
   return 0;
 }
 
+// Remove the entry for name, at byte offset off, from the
+// directory dp.
+void
+dirunlink(struct inode *dp, char *name, uint off)
+{
+  struct dirent de;
+
+  memset(&de, 0, sizeof(de));
+  if(writei(dp, (char*)&de, off, sizeof(de)) != sizeof(de))
+    panic("unlink: writei");
+  dput(dp, name, 0, 0);
+}
+
 //PAGEBREAK!
 // Paths
 
@@ -3,7 +3,12 @@
 
 
 #define ROOTINO 1  // root i-number
-#define BSIZE 512  // block size
+#ifndef BSIZE
+#define BSIZE 512  // block size; set with "make BSIZE=n"
+#endif
+#if BSIZE % 512 || BSIZE > 4096
+#error "BSIZE must be a multiple of the 512-byte sector, at most 4096"
+#endif
 
 // Disk layout:
 // [ boot block | super block | log | inode blocks |
@@ -21,9 +26,13 @@ struct superblock {
   uint bmapstart;    // Block number of first free map block
 };
 
-#define NDIRECT 12
+#define NDIRECT 11
 #define NINDIRECT (BSIZE / sizeof(uint))
-#define MAXFILE (NDIRECT + NINDIRECT)
+#define NDINDIRECT (NINDIRECT * NINDIRECT)
+// File sizes are uints, so with 4KB blocks the last few
+// double indirect blocks go unused.
+#define MAXBLOCKS (NDIRECT + NINDIRECT + NDINDIRECT)
+#define MAXFILE (MAXBLOCKS < 0xffffffff / BSIZE ? MAXBLOCKS : 0xffffffff / BSIZE)
 
 // On-disk inode structure
 struct dinode {
@@ -32,7 +41,7 @@ struct dinode {
   short minor;          // Minor device number (T_DEV only)
   short nlink;          // Number of links to inode in file system
   uint size;            // Size of file (bytes)
-  uint addrs[NDIRECT+1];   // Data block addresses
+  uint addrs[NDIRECT+2];   // Data block addresses
 };
 
 // Inodes per block.
@@ -0,0 +1,44 @@
+#include "types.h"
+#include "user.h"
+#include "perf.h"
+
+// Short-job comparison using the TSC-based wait_tstat().
+// Each child does a CPU burst much shorter than a tick, which
+// wait_stat() would mostly report as 0 ticks of running time.
+
+#define NJOBS 20
+
+int
+main(void)
+{
+    int pol, i, j;
+    uint sumRun, sumReady, sumSleep, sumTicks;
+    volatile int x;
+    struct tperf perf;
+
+    for (pol = 1; pol <= 4; pol++) {
+        policy(pol);
+        for (i = 0; i < NJOBS; i++) {
+            if (fork() == 0) {
+                x = 0;
+                for (j = 0; j < (i + 1) * 20000; j++)
+                    x += j;
+                exit(0);
+            }
+        }
+        sumRun = sumReady = sumSleep = sumTicks = 0;
+        for (i = 0; i < NJOBS; i++) {
+            if (wait_tstat(0, &perf) < 0)
+                break;
+            sumRun += perf.rutime_us;
+            sumReady += perf.retime_us;
+            sumSleep += perf.stime_us;
+            sumTicks += perf.ttime - perf.ctime;
+        }
+        printf(1, "policy %d: avg running %d us, ready %d us, sleeping %d us, "
+               "turnaround %d ticks\n", pol, sumRun / NJOBS, sumReady / NJOBS,
+               sumSleep / NJOBS, sumTicks / NJOBS);
+    }
+    policy(1);
+    exit(0);
+}
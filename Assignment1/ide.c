@@ -23,15 +23,22 @@
 #define IDE_CMD_WRITE 0x30
 #define IDE_CMD_RDMUL 0xc4
 #define IDE_CMD_WRMUL 0xc5
+#define IDE_CMD_SETMUL 0xc6
 
-// idequeue points to the buf now being read/written to the disk.
-// idequeue->qnext points to the next buf to be processed.
+#define MAXSECT       16  // sectors per command, see ideinit
+
+// idequeue points to the bufs now being read/written to the disk,
+// idebatch of them, for consecutive blocks, in one command.
+// The rest of the queue is in C-SCAN order: ascending from the
+// block in progress, then ascending from the lowest block.
 // You must hold idelock while manipulating queue.
 
 static struct spinlock idelock;
 static struct buf *idequeue;
+static int idebatch;
 
 static int havedisk1;
+static uint nwrites;  // blocks written, see idewrites()
 static void idestart(struct buf*);
 
 // Wait for IDE disk to become ready.
@@ -66,103 +73,181 @@ ideinit(void)
     }
   }
 
+  // Let READ/WRITE MULTIPLE move up to MAXSECT sectors
+  // per interrupt, so that a merged request is one transfer.
+  for(i = havedisk1; i >= 0; i--){
+    outb(0x1f6, 0xe0 | (i<<4));
+    idewait(0);
+    outb(0x1f2, MAXSECT);
+    outb(0x1f7, IDE_CMD_SETMUL);
+    idewait(0);
+  }
+
   // Switch back to disk 0.
   outb(0x1f6, 0xe0 | (0<<4));
 }
 
-// Start the request for b.  Caller must hold idelock.
+// Start the request for b, the head of idequeue, merged with
+// the requests after it for the following blocks in the same
+// direction, as one command.  Caller must hold idelock.
 static void
 idestart(struct buf *b)
 {
+  struct buf *q;
+  int i;
+
   if(b == 0)
     panic("idestart");
   if(b->blockno >= FSSIZE)
     panic("incorrect blockno");
   int sector_per_block =  BSIZE/SECTOR_SIZE;
   int sector = b->blockno * sector_per_block;
-  int read_cmd = (sector_per_block == 1) ? IDE_CMD_READ :  IDE_CMD_RDMUL;
-  int write_cmd = (sector_per_block == 1) ? IDE_CMD_WRITE : IDE_CMD_WRMUL;
 
-  if (sector_per_block > 7) panic("idestart");
+  if (sector_per_block > MAXSECT || BSIZE % SECTOR_SIZE) panic("idestart");
+
+  idebatch = 1;
+  for(q = b; q->qnext && (idebatch+1)*sector_per_block <= MAXSECT; q = q->qnext){
+    if(q->qnext->dev != b->dev || q->qnext->blockno != q->blockno + 1 ||
+       (q->qnext->flags & B_DIRTY) != (b->flags & B_DIRTY))
+      break;
+    idebatch++;
+  }
 
   idewait(0);
   outb(0x3f6, 0);  // generate interrupt
-  outb(0x1f2, sector_per_block);  // number of sectors
+  outb(0x1f2, idebatch*sector_per_block);  // number of sectors
   outb(0x1f3, sector & 0xff);
   outb(0x1f4, (sector >> 8) & 0xff);
   outb(0x1f5, (sector >> 16) & 0xff);
   outb(0x1f6, 0xe0 | ((b->dev&1)<<4) | ((sector>>24)&0x0f));
   if(b->flags & B_DIRTY){
-    outb(0x1f7, write_cmd);
-    outsl(0x1f0, b->data, BSIZE/4);
+    nwrites += idebatch;
+    outb(0x1f7, IDE_CMD_WRMUL);
+    for(q = b, i = 0; i < idebatch; q = q->qnext, i++)
+      outsl(0x1f0, q->data, BSIZE/4);
   } else {
-    outb(0x1f7, read_cmd);
+    outb(0x1f7, IDE_CMD_RDMUL);
   }
 }
 
+// Insert b into idequeue in C-SCAN order, after the requests
+// in progress.  Caller must hold idelock.
+static void
+ideinsert(struct buf *b)
+{
+  struct buf **pp;
+  uint cur;
+  int i;
+
+  pp = &idequeue;
+  if(idequeue){
+    // Distance along the sweep; blocks at or below the one in
+    // progress wrap around to the end.
+    cur = idequeue->blockno + 1;
+    for(i = 0; i < idebatch; i++)
+      pp = &(*pp)->qnext;
+    for(; *pp && (*pp)->blockno - cur <= b->blockno - cur; pp = &(*pp)->qnext)
+      ;
+  }
+  b->qnext = *pp;
+  *pp = b;
+}
+
 // Interrupt handler.
 void
 ideintr(void)
 {
-  struct buf *b;
+  struct buf *b, *async[MAXSECT];
+  int i, n, read;
 
-  // First queued buffer is the active request.
+  // The first idebatch queued buffers are the active request.
   acquire(&idelock);
   if((b = idequeue) == 0){
     release(&idelock);
     // cprintf("spurious IDE interrupt\n");
     return;
   }
-  idequeue = b->qnext;
-
-  // Read data if needed.
-  if(!(b->flags & B_DIRTY) && idewait(1) >= 0)
-    insl(0x1f0, b->data, BSIZE/4);
 
-  // Wake process waiting for this buf.
-  b->flags |= B_VALID;
-  b->flags &= ~B_DIRTY;
-  wakeup(b);
+  read = !(b->flags & B_DIRTY) && idewait(1) >= 0;
+  n = 0;
+  for(i = 0; i < idebatch; i++){
+    b = idequeue;
+    idequeue = b->qnext;
+
+    // Read data if needed.
+    if(read)
+      insl(0x1f0, b->data, BSIZE/4);
+
+    // Wake process waiting for this buf.
+    if(b->flags & B_ASYNC)
+      async[n++] = b;
+    b->flags |= B_VALID;
+    b->flags &= ~(B_DIRTY|B_ASYNC);
+    wakeup(b);
+  }
+  idebatch = 0;
 
   // Start disk on next buf in queue.
   if(idequeue != 0)
     idestart(idequeue);
 
   release(&idelock);
+
+  // Nobody waits for an asynchronous request; release the
+  // buffers on behalf of the processes that started them.
+  for(i = 0; i < n; i++)
+    brelse(async[i]);
 }
 
 //PAGEBREAK!
-// Sync buf with disk.
+// Queue a sync of buf with disk and return without waiting.
 // If B_DIRTY is set, write buf to disk, clear B_DIRTY, set B_VALID.
 // Else if B_VALID is not set, read buf from disk, set B_VALID.
+// b must stay locked until ideawait(b) returns; but if B_ASYNC
+// is set, nobody waits and ideintr() releases b when it is done.
 void
-iderw(struct buf *b)
+idesubmit(struct buf *b)
 {
-  struct buf **pp;
-
   if(!holdingsleep(&b->lock))
-    panic("iderw: buf not locked");
+    panic("idesubmit: buf not locked");
   if((b->flags & (B_VALID|B_DIRTY)) == B_VALID)
-    panic("iderw: nothing to do");
+    panic("idesubmit: nothing to do");
   if(b->dev != 0 && !havedisk1)
-    panic("iderw: ide disk 1 not present");
+    panic("idesubmit: ide disk 1 not present");
 
   acquire(&idelock);  //DOC:acquire-lock
 
-  // Append b to idequeue.
-  b->qnext = 0;
-  for(pp=&idequeue; *pp; pp=&(*pp)->qnext)  //DOC:insert-queue
-    ;
-  *pp = b;
+  ideinsert(b);  //DOC:insert-queue
 
   // Start disk if necessary.
-  if(idequeue == b)
-    idestart(b);
+  if(idebatch == 0)
+    idestart(idequeue);
 
-  // Wait for request to finish.
+  release(&idelock);
+}
+
+// Wait for the request for b queued by idesubmit() to finish.
+void
+ideawait(struct buf *b)
+{
+  acquire(&idelock);
   while((b->flags & (B_VALID|B_DIRTY)) != B_VALID){
     sleep(b, &idelock);
   }
-
   release(&idelock);
 }
+
+// Return the number of blocks written to disk since boot.
+int
+idewrites(void)
+{
+  return nwrites;
+}
+
+// Sync buf with disk, and wait for it.
+void
+iderw(struct buf *b)
+{
+  idesubmit(b);
+  ideawait(b);
+}
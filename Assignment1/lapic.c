@@ -67,7 +67,7 @@ lapicinit(void)
   // TICR would be calibrated using an external time source.
   lapicw(TDCR, X1);
   lapicw(TIMER, PERIODIC | (T_IRQ0 + IRQ_TIMER));
-  lapicw(TICR, 10000000);
+  lapicw(TICR, QUANTUM);
 
   // Disable logical interrupt lines.
   lapicw(LINT0, MASKED);
@@ -126,6 +126,16 @@ cpunum(void)
   panic("unknown apicid\n");
 }
 
+// Timer counts left until this CPU's next tick, out of QUANTUM.
+// Returns 0 if there is no lapic timer.
+uint
+lapictimer(void)
+{
+  if(!lapic)
+    return 0;
+  return lapic[TCCR];
+}
+
 // Acknowledge interrupt.
 void
 lapiceoi(void)
@@ -141,6 +151,45 @@ microdelay(int us)
 {
 }
 
+// PIT channel 2, used to calibrate the TSC.
+#define PIT_CH2      0x42
+#define PIT_MODE     0x43
+#define PIT_GATE     0x61     // bit 0: ch2 gate, bit 1: speaker, bit 5: ch2 out
+#define PIT_HZ       1193182
+#define CALIBRATE_MS 10
+
+uint tsckhz;  // TSC cycles per millisecond
+
+// Measure the TSC rate by counting cycles while PIT
+// channel 2 counts down CALIBRATE_MS milliseconds.
+void
+tscinit(void)
+{
+  uint latch;
+  uint64 t0, t1;
+
+  latch = PIT_HZ / 1000 * CALIBRATE_MS;
+  outb(PIT_GATE, (inb(PIT_GATE) & ~0x02) | 0x01);
+  outb(PIT_MODE, 0xB0);  // channel 2, lo/hi byte, mode 0
+  outb(PIT_CH2, latch & 0xFF);
+  outb(PIT_CH2, latch >> 8);
+  t0 = rdtsc();
+  while((inb(PIT_GATE) & 0x20) == 0)
+    ;
+  t1 = rdtsc();
+  tsckhz = div64(t1 - t0, CALIBRATE_MS);
+  cprintf("tsc: %d MHz\n", tsckhz / 1000);
+}
+
+// Convert TSC cycles to microseconds.
+uint
+tsc2us(uint64 cycles)
+{
+  if(tsckhz == 0)
+    return 0;
+  return div64(cycles * 1000, tsckhz);
+}
+
 #define CMOS_PORT    0x70
 #define CMOS_RETURN  0x71
 
@@ -17,8 +17,24 @@
 // A system call should call begin_op()/end_op() to mark
 // its start and end. Usually begin_op() just increments
 // the count of in-progress FS system calls and returns.
-// But if it thinks the log is close to running out, it
-// sleeps until the last outstanding end_op() commits.
+// But if it thinks the transaction is close to running out
+// of space, it sleeps until the transaction starts committing.
+//
+// Transactions are double-buffered. A commit first copies the
+// transaction's blocks out of the buffer cache into private
+// shadow buffers, and only new FS system calls wait while it
+// does so. A new transaction then opens and fills while the
+// committing one is written to the log. If the new transaction
+// is quiet by the time the commit finishes, the same process
+// commits it too, so a burst of writers shares one commit
+// (group commit).
+//
+// Checkpointing is lazy. A commit appends the transaction to the
+// on-disk log and leaves its blocks pinned in the buffer cache.
+// Only when the log could not take another transaction, or on
+// log_sync(), are the logged blocks written to their home
+// locations, once each however many transactions wrote them,
+// and the log emptied. New FS system calls wait for that.
 //
 // The log is a physical re-do log containing disk blocks.
 // The on-disk log format:
@@ -27,6 +43,7 @@
 //   block B
 //   block C
 //   ...
+// A block may appear more than once; the last copy wins.
 // Log appends are synchronous.
 
 // Contents of the header block, used for both the on-disk header block
@@ -41,12 +58,21 @@ struct log {
   int start;
   int size;
   int outstanding; // how many FS sys calls are executing.
-  int committing;  // in commit(), please wait.
+  int committing;  // in commit().
+  int freezing;    // commit() is copying blocks or checkpointing, please wait.
+  int checkpoint;  // commit() will checkpoint after this transaction.
+  int syncing;     // log_sync() is waiting to checkpoint.
   int dev;
-  struct logheader lh;
+  struct logheader lh;   // the open transaction
+  struct logheader clh;  // the committing transaction
+  struct logheader dlh;  // committed transactions on disk
 };
 struct log log;
 
+// Copies of the committing transaction's blocks,
+// written to the log.
+static struct buf shadow[MAXTXBLOCKS];
+
 static void recover_from_log(void);
 static void commit();
 
@@ -57,27 +83,61 @@ initlog(int dev)
     panic("initlog: too big logheader");
 
   struct superblock sb;
+  int i;
+
   initlock(&log.lock, "log");
+  for (i = 0; i < MAXTXBLOCKS; i++)
+    initsleeplock(&shadow[i].lock, "shadow");
   readsb(dev, &sb);
   log.start = sb.logstart;
   log.size = sb.nlog;
   log.dev = dev;
+  if (log.size - 1 < MAXTXBLOCKS || log.size - 1 > LOGSIZE)
+    panic("initlog: bad log size");
   recover_from_log();
 }
 
-// Copy committed blocks from log to their home location
+// Is the copy of a block in log slot tail overwritten
+// by a later one?
+static int
+superseded(int tail)
+{
+  int i;
+
+  for (i = tail + 1; i < log.dlh.n; i++) {
+    if (log.dlh.block[i] == log.dlh.block[tail])
+      return 1;
+  }
+  return 0;
+}
+
+// Copy committed blocks to their home location, from the log
+// during recovery and from the pinned cache blocks otherwise.
 static void
-install_trans(void)
+install_trans(int recovering)
 {
   int tail;
+  struct buf *dbuf[LOGSIZE];
 
-  for (tail = 0; tail < log.lh.n; tail++) {
-    struct buf *lbuf = bread(log.dev, log.start+tail+1); // read log block
-    struct buf *dbuf = bread(log.dev, log.lh.block[tail]); // read dst
-    memmove(dbuf->data, lbuf->data, BSIZE);  // copy block to dst
-    bwrite(dbuf);  // write dst to disk
-    brelse(lbuf);
-    brelse(dbuf);
+  // Queue all the writes, then wait, so that the disk
+  // driver can sort and merge them.
+  for (tail = 0; tail < log.dlh.n; tail++) {
+    dbuf[tail] = 0;
+    if (superseded(tail))
+      continue;
+    dbuf[tail] = bread(log.dev, log.dlh.block[tail]); // read dst
+    if (recovering) {
+      struct buf *lbuf = bread(log.dev, log.start+tail+1); // read log block
+      memmove(dbuf[tail]->data, lbuf->data, BSIZE);  // copy block to dst
+      brelse(lbuf);
+    }
+    bwrite_start(dbuf[tail]);  // write dst to disk, unpinning it
+  }
+  for (tail = 0; tail < log.dlh.n; tail++) {
+    if (dbuf[tail] == 0)
+      continue;
+    bwrite_wait(dbuf[tail]);
+    brelse(dbuf[tail]);
   }
 }
 
@@ -88,9 +148,9 @@ read_head(void)
   struct buf *buf = bread(log.dev, log.start);
   struct logheader *lh = (struct logheader *) (buf->data);
   int i;
-  log.lh.n = lh->n;
-  for (i = 0; i < log.lh.n; i++) {
-    log.lh.block[i] = lh->block[i];
+  log.dlh.n = lh->n;
+  for (i = 0; i < log.dlh.n; i++) {
+    log.dlh.block[i] = lh->block[i];
   }
   brelse(buf);
 }
@@ -104,9 +164,9 @@ write_head(void)
   struct buf *buf = bread(log.dev, log.start);
   struct logheader *hb = (struct logheader *) (buf->data);
   int i;
-  hb->n = log.lh.n;
-  for (i = 0; i < log.lh.n; i++) {
-    hb->block[i] = log.lh.block[i];
+  hb->n = log.dlh.n;
+  for (i = 0; i < log.dlh.n; i++) {
+    hb->block[i] = log.dlh.block[i];
   }
   bwrite(buf);
   brelse(buf);
@@ -116,8 +176,8 @@ static void
 recover_from_log(void)
 {
   read_head();
-  install_trans(); // if committed, copy from log to disk
-  log.lh.n = 0;
+  install_trans(1); // if committed, copy from log to disk
+  log.dlh.n = 0;
   write_head(); // clear the log
 }
 
@@ -127,10 +187,10 @@ begin_op(void)
 {
   acquire(&log.lock);
   while(1){
-    if(log.committing){
+    if(log.freezing || log.syncing){
       sleep(&log, &log.lock);
-    } else if(log.lh.n + (log.outstanding+1)*MAXOPBLOCKS > LOGSIZE){
-      // this op might exhaust log space; wait for commit.
+    } else if(log.lh.n + (log.outstanding+1)*MAXOPBLOCKS > MAXTXBLOCKS){
+      // this op might exhaust transaction space; wait for commit.
       sleep(&log, &log.lock);
     } else {
       log.outstanding += 1;
@@ -140,8 +200,24 @@ begin_op(void)
   }
 }
 
+// Freeze the open transaction for commit() and open a new one.
+// Checkpoint after it if asked to or if the log might not
+// have room for the next transaction.
+// Caller must hold log.lock.
+static void
+freeze(int checkpoint)
+{
+  log.clh = log.lh;
+  log.lh.n = 0;
+  log.committing = 1;
+  log.freezing = 1;
+  log.checkpoint = checkpoint ||
+    log.dlh.n + log.clh.n + MAXTXBLOCKS > log.size - 1;
+}
+
 // called at the end of each FS system call.
-// commits if this was the last outstanding operation.
+// commits if this was the last outstanding operation
+// and no other commit is in progress.
 void
 end_op(void)
 {
@@ -149,11 +225,11 @@ end_op(void)
 
   acquire(&log.lock);
   log.outstanding -= 1;
-  if(log.committing)
-    panic("log.committing");
-  if(log.outstanding == 0){
+  if(log.freezing)
+    panic("log.freezing");
+  if(log.outstanding == 0 && !log.committing && log.lh.n > 0){
     do_commit = 1;
-    log.committing = 1;
+    freeze(0);
   } else {
     // begin_op() may be waiting for log space.
     wakeup(&log);
@@ -164,44 +240,100 @@ end_op(void)
     // call commit w/o holding locks, since not allowed
     // to sleep with locks.
     commit();
-    acquire(&log.lock);
-    log.committing = 0;
-    wakeup(&log);
-    release(&log.lock);
   }
 }
 
-// Copy modified blocks from cache to log.
+// Commit the open transaction and checkpoint the log, so that
+// everything written so far is at its home location on disk.
+void
+log_sync(void)
+{
+  acquire(&log.lock);
+  log.syncing += 1;
+  while(log.committing || log.outstanding > 0)
+    sleep(&log, &log.lock);
+  log.syncing -= 1;
+  freeze(1);
+  release(&log.lock);
+  commit();
+}
+
+// Copy the committing transaction's blocks from the cache
+// to the shadows, let new FS system calls start unless a
+// checkpoint follows, and append the shadows to the log.
 static void
 write_log(void)
 {
   int tail;
+  struct buf *s, *from;
 
-  for (tail = 0; tail < log.lh.n; tail++) {
-    struct buf *to = bread(log.dev, log.start+tail+1); // log block
-    struct buf *from = bread(log.dev, log.lh.block[tail]); // cache block
-    memmove(to->data, from->data, BSIZE);
-    bwrite(to);  // write the log
+  // The log blocks are consecutive, so the disk driver
+  // writes them in a few multi-sector commands.
+  for (tail = 0; tail < log.clh.n; tail++) {
+    s = &shadow[tail];
+    acquiresleep(&s->lock);
+    from = bread(log.dev, log.clh.block[tail]); // cache block
+    memmove(s->data, from->data, BSIZE);
     brelse(from);
-    brelse(to);
+    s->dev = log.dev;
+    s->blockno = log.start+log.dlh.n+tail+1;  // log block
+    s->flags = B_VALID;
+    bwrite_start(s);  // write the log
+  }
+
+  if(!log.checkpoint){
+    acquire(&log.lock);
+    log.freezing = 0;
+    wakeup(&log);
+    release(&log.lock);
+  }
+
+  for (tail = 0; tail < log.clh.n; tail++) {
+    bwrite_wait(&shadow[tail]);
+    releasesleep(&shadow[tail].lock);
   }
 }
 
+// Commit the frozen transaction, then any transaction
+// that became ready in the meantime.
 static void
 commit()
 {
-  if (log.lh.n > 0) {
-    write_log();     // Write modified blocks from cache to log
-    write_head();    // Write header to disk -- the real commit
-    install_trans(); // Now install writes to home locations
-    log.lh.n = 0;
-    write_head();    // Erase the transaction from the log
+  int tail;
+
+  for (;;) {
+    if (log.clh.n > 0) {
+      write_log();     // Write modified blocks from cache to log
+      for (tail = 0; tail < log.clh.n; tail++)
+        log.dlh.block[log.dlh.n++] = log.clh.block[tail];
+      write_head();    // Write header to disk -- the real commit
+      log.clh.n = 0;
+    }
+    if (log.checkpoint && log.dlh.n > 0) {
+      // No FS system call has run since the freeze, so the
+      // pinned cache blocks hold exactly the committed data.
+      install_trans(0); // Now install writes to home locations
+      log.dlh.n = 0;
+      write_head();    // Erase the transactions from the log
+    }
+
+    acquire(&log.lock);
+    log.freezing = 0;
+    if(log.outstanding == 0 && log.lh.n > 0 && !log.syncing){
+      freeze(0);
+      release(&log.lock);
+      continue;
+    }
+    log.committing = 0;
+    wakeup(&log);
+    release(&log.lock);
+    return;
   }
 }
 
 // Caller has modified b->data and is done with the buffer.
 // Record the block number and pin in the cache with B_DIRTY.
-// commit()/write_log() will do the disk write.
+// The block stays pinned until a checkpoint writes it home.
 //
 // log_write() replaces bwrite(); a typical use is:
 //   bp = bread(...)
@@ -213,7 +345,7 @@ log_write(struct buf *b)
 {
   int i;
 
-  if (log.lh.n >= LOGSIZE || log.lh.n >= log.size - 1)
+  if (log.lh.n >= MAXTXBLOCKS)
     panic("too big a transaction");
   if (log.outstanding < 1)
     panic("log_write outside of trans");
@@ -229,4 +361,3 @@ log_write(struct buf *b)
   b->flags |= B_DIRTY; // prevent eviction
   release(&log.lock);
 }
-
@@ -0,0 +1,70 @@
+// logbench: file system commit throughput with concurrent writers.
+// For 1, 2, 4 and 8 writers, each writer creates its own file and
+// appends small records to it, like stressfs and usertests'
+// fourfiles. Every write is its own log transaction, so the total
+// rate shows how well commits are shared between writers.
+//
+//   logbench [nwrites]
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "fcntl.h"
+
+#define HZ 100       // approximate timer ticks per second under qemu
+#define MAXWRITERS 8
+#define RECSIZE 128
+
+char rec[RECSIZE];
+
+void
+writer(int i, int nwrites)
+{
+  char name[8];
+  int fd, j;
+
+  strcpy(name, "logb0");
+  name[4] = '0' + i;
+  unlink(name);
+  if((fd = open(name, O_CREATE|O_RDWR)) < 0){
+    printf(2, "logbench: cannot create %s\n", name);
+    exit(-1);
+  }
+  memset(rec, 'a' + i, sizeof(rec));
+  for(j = 0; j < nwrites; j++){
+    if(write(fd, rec, sizeof(rec)) != sizeof(rec)){
+      printf(2, "logbench: write failed\n");
+      exit(-1);
+    }
+  }
+  close(fd);
+  unlink(name);
+  exit(0);
+}
+
+int
+main(int argc, char *argv[])
+{
+  int nw, i, nwrites, start, elapsed;
+
+  nwrites = argc > 1 ? atoi(argv[1]) : 200;
+  if(nwrites < 1){
+    printf(2, "usage: logbench [nwrites]\n");
+    exit(-1);
+  }
+  for(nw = 1; nw <= MAXWRITERS; nw *= 2){
+    start = uptime();
+    for(i = 0; i < nw; i++){
+      if(fork() == 0)
+        writer(i, nwrites);
+    }
+    for(i = 0; i < nw; i++)
+      wait(0);
+    elapsed = uptime() - start;
+    if(elapsed < 1)
+      elapsed = 1;
+    printf(1, "logbench: %d writers, %d writes in %d ticks, %d writes/sec\n",
+           nw, nw * nwrites, elapsed, nw * nwrites * HZ / elapsed);
+  }
+  exit(0);
+}
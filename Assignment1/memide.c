@@ -13,16 +13,17 @@
 #include "fs.h"
 #include "buf.h"
 
-extern uchar _binary_fs_img_start[], _binary_fs_img_size[];
+extern uchar _binary_fsmem_img_start[], _binary_fsmem_img_size[];
 
 static int disksize;
 static uchar *memdisk;
+static uint nwrites;  // blocks written, see idewrites()
 
 void
 ideinit(void)
 {
-  memdisk = _binary_fs_img_start;
-  disksize = (uint)_binary_fs_img_size/BSIZE;
+  memdisk = _binary_fsmem_img_start;
+  disksize = (uint)_binary_fsmem_img_size/BSIZE;
 }
 
 // Interrupt handler.
@@ -32,6 +33,23 @@ ideintr(void)
   // no-op
 }
 
+// The memory disk has no latency to hide, so requests
+// complete right away.
+void
+idesubmit(struct buf *b)
+{
+  iderw(b);
+  if(b->flags & B_ASYNC){
+    b->flags &= ~B_ASYNC;
+    brelse(b);
+  }
+}
+
+void
+ideawait(struct buf *b)
+{
+}
+
 // Sync buf with disk.
 // If B_DIRTY is set, write buf to disk, clear B_DIRTY, set B_VALID.
 // Else if B_VALID is not set, read buf from disk, set B_VALID.
@@ -54,7 +72,15 @@ iderw(struct buf *b)
   if(b->flags & B_DIRTY){
     b->flags &= ~B_DIRTY;
     memmove(p, b->data, BSIZE);
+    nwrites++;
   } else
     memmove(b->data, p, BSIZE);
   b->flags |= B_VALID;
 }
+
+// Return the number of blocks written to disk since boot.
+int
+idewrites(void)
+{
+  return nwrites;
+}
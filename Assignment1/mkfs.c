@@ -282,7 +282,7 @@ iappend(uint inum, void *xp, int n)
   struct dinode din;
   char buf[BSIZE];
   uint indirect[NINDIRECT];
-  uint x;
+  uint x, ind, i;
 
   rinode(inum, &din);
   off = xint(din.size);
@@ -295,7 +295,7 @@ iappend(uint inum, void *xp, int n)
         din.addrs[fbn] = xint(freeblock++);
       }
       x = xint(din.addrs[fbn]);
-    } else {
+    } else if(fbn < NDIRECT + NINDIRECT){
       if(xint(din.addrs[NDIRECT]) == 0){
         din.addrs[NDIRECT] = xint(freeblock++);
       }
@@ -305,6 +305,24 @@ iappend(uint inum, void *xp, int n)
         wsect(xint(din.addrs[NDIRECT]), (char*)indirect);
       }
       x = xint(indirect[fbn-NDIRECT]);
+    } else {
+      if(xint(din.addrs[NDIRECT+1]) == 0){
+        din.addrs[NDIRECT+1] = xint(freeblock++);
+      }
+      rsect(xint(din.addrs[NDIRECT+1]), (char*)indirect);
+      i = (fbn - NDIRECT - NINDIRECT) / NINDIRECT;
+      if(indirect[i] == 0){
+        indirect[i] = xint(freeblock++);
+        wsect(xint(din.addrs[NDIRECT+1]), (char*)indirect);
+      }
+      ind = xint(indirect[i]);
+      rsect(ind, (char*)indirect);
+      i = (fbn - NDIRECT - NINDIRECT) % NINDIRECT;
+      if(indirect[i] == 0){
+        indirect[i] = xint(freeblock++);
+        wsect(ind, (char*)indirect);
+      }
+      x = xint(indirect[i]);
     }
     n1 = min(n, (fbn + 1) * BSIZE - off);
     rsect(x, buf);
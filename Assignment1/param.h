@@ -2,13 +2,20 @@
 #define KSTACKSIZE 4096  // size of per-process kernel stack
 #define NCPU          8  // maximum number of CPUs
 #define NOFILE       16  // open files per process
-#define NFILE       100  // open files per system
-#define NINODE       50  // maximum number of active i-nodes
+#define NFILE      1000  // open files per system
+#define NINODE      500  // maximum number of cached i-nodes
 #define NDEV         10  // maximum major device number
 #define ROOTDEV       1  // device number of file system root disk
 #define MAXARG       32  // max exec arguments
 #define MAXOPBLOCKS  10  // max # of blocks any FS op writes
-#define LOGSIZE      (MAXOPBLOCKS*3)  // max data blocks in on-disk log
-#define NBUF         (MAXOPBLOCKS*3)  // size of disk block cache
-#define FSSIZE       1000  // size of file system in blocks
+#define MAXTXBLOCKS  (MAXOPBLOCKS*3)  // max data blocks in one log transaction
+#define LOGSIZE      (MAXOPBLOCKS*12) // max data blocks in on-disk log
+#define NBUF         256  // size of disk block cache
+#define NBUCKET      31  // hash buckets in the disk block cache
+#define NIBUCKET     31  // hash buckets in the inode cache
+#define NDENTRY     256  // entries in the directory name cache
+#ifndef FSSIZE
+#define FSSIZE       20000 // size of file system in blocks
+#endif
+#define QUANTUM  10000000  // lapic timer counts per scheduling quantum
 
@@ -4,5 +4,21 @@ struct perf {
   int stime;
   int retime;
   int rutime;
+  int migrations;
+};
+
+// High-resolution times, filled in by wait_tstat().
+// stime/retime/rutime are TSC cycles; the _us fields are the same
+// times in microseconds, using the TSC rate calibrated at boot.
+struct tperf {
+  int ctime;
+  int ttime;
+  uint64 stime;
+  uint64 retime;
+  uint64 rutime;
+  uint stime_us;
+  uint retime_us;
+  uint rutime_us;
+  int migrations;
 };
  
@@ -11,12 +11,38 @@
 #define UNIFORM 1
 #define PRIORITY 2
 #define DYNAMIC 3
+#define STRIDE 4
+
+#define STRIDE1 (1 << 16)  // stride of a process holding one ticket
+#define RQWALK 8           // up to this many queued, draw by walking the bitmap
 
 struct {
   struct spinlock lock;
   struct proc proc[NPROC];
 } ptable;
 
+// Per-CPU run queue. Each CPU draws its lottery among the RUNNABLE
+// processes queued on it. Their tickets are kept in a Fenwick tree
+// indexed by slot in ptable.proc, so the ticket total is known
+// without a scan and the winner is found in O(log NPROC).
+// With only a few processes queued, the draw instead walks a bitmap
+// of queued slots with bsf, in time proportional to their number.
+// Under STRIDE the CPU instead runs the process with the lowest
+// pass, taken from a min-heap of the same processes.
+// Lock order is ptable.lock, then a run queue lock.
+struct runq {
+  struct spinlock lock;
+  int tickets[NPROC+1];  // Fenwick tree of queued tickets, 1-based
+  int weight[NPROC];     // tickets each slot currently holds in the tree
+  uint total;            // sum of the tickets of all queued processes
+  uint queued[(NPROC+31)/32]; // bitmap of queued slots
+  struct proc *heap[NPROC]; // queued processes, a min-heap on pass
+  int nproc;             // number of queued processes
+  uint pass;             // pass of the last process picked under STRIDE
+};
+
+static struct runq runqs[NCPU];
+
 static struct proc *initproc;
 int nextpid = 1;
 extern void forkret(void);
@@ -28,7 +54,348 @@ static void wakeup1(void *chan);
 void
 pinit(void)
 {
+  struct proc *p;
+  struct runq *rq;
+
   initlock(&ptable.lock, "ptable");
+  for(rq = runqs; rq < &runqs[NCPU]; rq++)
+    initlock(&rq->lock, "runq");
+  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++)
+    p->rq = -1;
+}
+
+//PAGEBREAK: 30
+// Run queue operations. Callers must hold rq->lock.
+
+// Set the number of tickets slot p holds in rq's tree.
+static void
+rq_set(struct runq *rq, struct proc *p, int w)
+{
+  int i, delta;
+
+  i = p - ptable.proc;
+  delta = w - rq->weight[i];
+  rq->weight[i] = w;
+  rq->total += delta;
+  for(i++; i <= NPROC; i += i & -i)
+    rq->tickets[i] += delta;
+}
+
+// Return the queued process holding ticket t, where t < rq->total.
+static struct proc*
+rq_find(struct runq *rq, uint t)
+{
+  int i, step;
+
+  for(step = 1; step*2 <= NPROC; step <<= 1)
+    ;
+  for(i = 0; step > 0; step >>= 1){
+    if(i + step <= NPROC && rq->tickets[i+step] <= t){
+      i += step;
+      t -= rq->tickets[i];
+    }
+  }
+  return &ptable.proc[i];
+}
+
+// Same as rq_find(), but visits only the queued slots.
+static struct proc*
+rq_walk(struct runq *rq, uint t)
+{
+  uint w, i, bits;
+
+  for(w = 0; w < NELEM(rq->queued); w++){
+    for(bits = rq->queued[w]; bits; bits &= bits - 1){
+      i = w*32 + bsf(bits);
+      if(t < rq->weight[i])
+        return &ptable.proc[i];
+      t -= rq->weight[i];
+    }
+  }
+  panic("rq_walk");
+}
+
+// Passes only ever move forward, and the passes in a queue stay
+// within a few strides of each other, so compare them modulo 2^32.
+static int
+passless(struct proc *a, struct proc *b)
+{
+  return (int)(a->pass - b->pass) < 0;
+}
+
+static void
+heap_set(struct runq *rq, int i, struct proc *p)
+{
+  rq->heap[i] = p;
+  p->hidx = i;
+}
+
+static void
+heap_up(struct runq *rq, int i)
+{
+  struct proc *p;
+
+  p = rq->heap[i];
+  while(i > 0 && passless(p, rq->heap[(i-1)/2])){
+    heap_set(rq, i, rq->heap[(i-1)/2]);
+    i = (i-1)/2;
+  }
+  heap_set(rq, i, p);
+}
+
+static void
+heap_down(struct runq *rq, int i)
+{
+  struct proc *p;
+  int c;
+
+  p = rq->heap[i];
+  while((c = 2*i + 1) < rq->nproc){
+    if(c+1 < rq->nproc && passless(rq->heap[c+1], rq->heap[c]))
+      c++;
+    if(!passless(rq->heap[c], p))
+      break;
+    heap_set(rq, i, rq->heap[c]);
+    i = c;
+  }
+  heap_set(rq, i, p);
+}
+
+static void
+heap_remove(struct runq *rq, struct proc *p)
+{
+  int i;
+
+  i = p->hidx;
+  rq->nproc--;
+  if(i == rq->nproc)
+    return;
+  heap_set(rq, i, rq->heap[rq->nproc]);
+  heap_down(rq, i);
+  heap_up(rq, rq->heap[i]->hidx);
+}
+
+uint generate_random_ticket(uint tick, uint sum)
+{
+    return ((tick * 212344L + 1234123L) % sum);
+}
+
+// Add p to the queue of the CPU it should run on: the one it
+// last ran on, where its cache is likely still warm, unless its
+// affinity excludes that CPU; then this CPU, or else the first
+// one its affinity allows.
+static void
+rq_enqueue(struct proc *p)
+{
+  struct runq *rq;
+  int c, i;
+
+  if(p->lastcpu >= 0 && (p->affinity & (1U << p->lastcpu)))
+    c = p->lastcpu;
+  else if(p->affinity & (1U << (cpu - cpus)))
+    c = cpu - cpus;
+  else
+    for(c = 0; c < ncpu-1 && !(p->affinity & (1U << c)); c++)
+      ;
+  rq = &runqs[c];
+
+  acquire(&rq->lock);
+  p->rq = c;
+  rq_set(rq, p, p->ntickets);
+  // a process does not bank passes while it is away
+  if((int)(p->pass - rq->pass) < 0)
+    p->pass = rq->pass;
+  heap_set(rq, rq->nproc++, p);
+  heap_up(rq, p->hidx);
+  i = p - ptable.proc;
+  rq->queued[i/32] |= 1U << i%32;
+  release(&rq->lock);
+}
+
+// Remove p from rq. Caller must hold rq->lock.
+static void
+rq_dequeue(struct runq *rq, struct proc *p)
+{
+  int i;
+
+  rq_set(rq, p, 0);
+  heap_remove(rq, p);
+  i = p - ptable.proc;
+  rq->queued[i/32] &= ~(1U << i%32);
+  p->rq = -1;
+}
+
+// Choose the next process for CPU c from rq: the lottery winner,
+// or under STRIDE the process with the lowest pass. Everything on
+// c's own queue may run on c, but a peer's queue may hold processes
+// whose affinity excludes c, so a steal walks the bitmap and only
+// considers the rest. Sets *t and *total to the draw, for the trace.
+// Caller must hold rq->lock.
+static struct proc*
+rq_choose(struct runq *rq, int c, uint *t, uint *total)
+{
+  struct proc *p, *q;
+  uint w, bits, sum, u;
+
+  if(rq == &runqs[c]){
+    if(current_policy == STRIDE){
+      if(rq->nproc == 0)
+        return 0;
+      p = rq->heap[0];
+      *t = p->pass;
+      *total = rq->total;
+      return p;
+    }
+    if(rq->total == 0)
+      return 0;
+    *total = rq->total;
+    *t = generate_random_ticket(ticks, rq->total);
+    return rq->nproc <= RQWALK ? rq_walk(rq, *t) : rq_find(rq, *t);
+  }
+
+  p = 0;
+  sum = 0;
+  for(w = 0; w < NELEM(rq->queued); w++){
+    for(bits = rq->queued[w]; bits; bits &= bits - 1){
+      q = &ptable.proc[w*32 + bsf(bits)];
+      if(!(q->affinity & (1U << c)))
+        continue;
+      if(p == 0 || passless(q, p))
+        p = q;
+      sum += rq->weight[q - ptable.proc];
+    }
+  }
+  *total = sum;
+  if(current_policy == STRIDE || p == 0){
+    if(p)
+      *t = p->pass;
+    return p;
+  }
+  if(sum == 0)
+    return 0;
+  u = *t = generate_random_ticket(ticks, sum);
+  for(w = 0; w < NELEM(rq->queued); w++){
+    for(bits = rq->queued[w]; bits; bits &= bits - 1){
+      q = &ptable.proc[w*32 + bsf(bits)];
+      if(!(q->affinity & (1U << c)))
+        continue;
+      if(u < rq->weight[q - ptable.proc])
+        return q;
+      u -= rq->weight[q - ptable.proc];
+    }
+  }
+  panic("rq_choose");
+}
+
+// Pick the next process for CPU c to run from rq and dequeue it.
+// Under STRIDE it is charged one stride. The process stays
+// RUNNABLE until the caller switches to it.
+// Return 0 if rq has nothing c may run.
+static struct proc*
+rq_pick(struct runq *rq, int c)
+{
+  struct proc *p;
+  uint t, total;
+
+  acquire(&rq->lock);
+  if((p = rq_choose(rq, c, &t, &total)) != 0){
+    schedtrace(p, RUNNABLE, RUNNING, t, total);
+    if(current_policy == STRIDE){
+      rq->pass = p->pass;
+      p->pass += p->stride;
+    }
+    rq_dequeue(rq, p);
+  }
+  release(&rq->lock);
+  return p;
+}
+
+// Called by idle CPU c: take a process from the peer with the
+// most queued processes, or if none of those may run on c,
+// from the next busiest, and so on.
+static struct proc*
+rq_steal(int c)
+{
+  struct runq *rq, *busiest;
+  struct proc *p;
+  uint tried;
+
+  for(tried = 1U << c; ; tried |= 1U << (busiest - runqs)){
+    busiest = 0;
+    for(rq = runqs; rq < &runqs[ncpu]; rq++)
+      if(!(tried & (1U << (rq - runqs))) && rq->nproc > 0 &&
+         (busiest == 0 || rq->nproc > busiest->nproc))
+        busiest = rq;
+    if(busiest == 0)
+      return 0;
+    if((p = rq_pick(busiest, c)) != 0)
+      return p;
+  }
+}
+
+// Bring p's share of its run queue in line with its ntickets.
+// Call with ptable.lock held after changing p->ntickets.
+static void
+tickets_sync(struct proc *p)
+{
+  struct runq *rq;
+  int n;
+
+  // rq_pick() may dequeue p concurrently; recheck under the lock.
+  if((n = p->rq) < 0)
+    return;
+  rq = &runqs[n];
+  acquire(&rq->lock);
+  if(p->rq == n)
+    rq_set(rq, p, p->ntickets);
+  release(&rq->lock);
+}
+
+// Set p's tickets, and its stride to match.
+// Call with ptable.lock held.
+static void
+settickets(struct proc *p, int n)
+{
+  p->ntickets = n;
+  p->stride = STRIDE1 / (n > 0 ? n : 1);
+  tickets_sync(p);
+}
+
+// Change p's state, queueing it if it became RUNNABLE, and
+// charge the ticks since the last change to the old state.
+// Dispatches are traced by rq_pick(), which knows the draw.
+// Caller must hold ptable.lock.
+static void
+setstate(struct proc *p, enum procstate state)
+{
+  uint now;
+  uint64 tsc;
+
+  now = ticks;
+  tsc = rdtsc();
+  switch(p->state){
+  case SLEEPING:
+    p->stime += now - p->stamp;
+    p->tstime += tsc - p->tstamp;
+    break;
+  case RUNNABLE:
+    p->retime += now - p->stamp;
+    p->tretime += tsc - p->tstamp;
+    break;
+  case RUNNING:
+    p->rutime += now - p->stamp;
+    p->trutime += tsc - p->tstamp;
+    break;
+  default:
+    break;
+  }
+  p->stamp = now;
+  p->tstamp = tsc;
+  if(state != RUNNING)
+    schedtrace(p, p->state, state, 0, 0);
+  p->state = state;
+  if(state == RUNNABLE)
+    rq_enqueue(p);
 }
 
 //PAGEBREAK: 32
@@ -60,15 +427,25 @@ found:
   p->stime = 0;
   p->retime = 0;
   p->rutime = 0;
+  p->tstime = 0;
+  p->tretime = 0;
+  p->trutime = 0;
+  p->pass = 0;
+  p->lastcpu = -1;
+  p->affinity = ~0;
+  p->migrations = 0;
   switch(current_policy) {
       case UNIFORM:
-            p->ntickets = 1;
+            settickets(p, 1);
         break;
         case PRIORITY:
-            p->ntickets = 10;
+            settickets(p, 10);
         break;
         case DYNAMIC:
-            p->ntickets = 20;
+            settickets(p, 20);
+        break;
+        case STRIDE:
+            settickets(p, p->priority);
         break;
         default:
             cprintf("Unknown policy number\n");
@@ -133,7 +510,7 @@ userinit(void)
   // because the assignment might not be atomic.
   acquire(&ptable.lock);
 
-  p->state = RUNNABLE;
+  setstate(p, RUNNABLE);
 
   release(&ptable.lock);
 }
@@ -147,8 +524,15 @@ growproc(int n)
 
   sz = proc->sz;
   if(n > 0){
-    if((sz = allocuvm(proc->pgdir, sz, sz + n)) == 0)
+    // Only reserve the address space; each page is allocated
+    // and zeroed when first touched, see lazyfault(). Still fail,
+    // as allocating the pages now would, if there are not that
+    // many free pages, so that malloc() can return 0.
+    if(sz + n >= KERNBASE || sz + n < sz)
       return -1;
+    if((PGROUNDUP(sz + n) - PGROUNDUP(sz)) / PGSIZE > kfreepages())
+      return -1;
+    sz += n;
   } else if(n < 0){
     if((sz = deallocuvm(proc->pgdir, sz, sz + n)) == 0)
       return -1;
@@ -181,6 +565,7 @@ fork(void)
   }
   np->sz = proc->sz;
   np->parent = proc;
+  np->affinity = proc->affinity;
   *np->tf = *proc->tf;
 
   // Clear %eax so that fork returns 0 in the child.
@@ -197,7 +582,7 @@ fork(void)
 
   acquire(&ptable.lock);
 
-  np->state = RUNNABLE;
+  setstate(np, RUNNABLE);
 
   release(&ptable.lock);
 
@@ -246,7 +631,7 @@ exit(int status)
   }
 
   // Jump into the scheduler, never to return.
-  proc->state = ZOMBIE;
+  setstate(proc, ZOMBIE);
   proc->ttime = ticks;
   sched();
   panic("zombie exit");
@@ -254,8 +639,9 @@ exit(int status)
 
 // Wait for a child process to exit and return its pid.
 // Return -1 if this process has no children.
-int
-wait(int *status)
+// If perf or tperf is non-zero, fill it in with the child's times.
+static int
+waitchild(int *status, struct perf *perf, struct tperf *tperf)
 {
   struct proc *p;
   int havekids, pid;
@@ -271,6 +657,7 @@ wait(int *status)
       if(p->state == ZOMBIE){
         // Found one.
         pid = p->pid;
+        setstate(p, UNUSED);
         kfree(p->kstack);
         p->kstack = 0;
         freevm(p->pgdir);
@@ -278,7 +665,25 @@ wait(int *status)
         p->parent = 0;
         p->name[0] = 0;
         p->killed = 0;
-        p->state = UNUSED;
+        if(perf) {
+            perf->ctime = p->ctime;
+            perf->ttime = p->ttime;
+            perf->stime = p->stime;
+            perf->retime = p->retime;
+            perf->rutime = p->rutime;
+            perf->migrations = p->migrations;
+        }
+        if(tperf) {
+            tperf->ctime = p->ctime;
+            tperf->ttime = p->ttime;
+            tperf->stime = p->tstime;
+            tperf->retime = p->tretime;
+            tperf->rutime = p->trutime;
+            tperf->stime_us = tsc2us(p->tstime);
+            tperf->retime_us = tsc2us(p->tretime);
+            tperf->rutime_us = tsc2us(p->trutime);
+            tperf->migrations = p->migrations;
+        }
         if(status) {
             *status = p->exit_status;
         }
@@ -298,11 +703,20 @@ wait(int *status)
   }
 }
 
+int
+wait(int *status)
+{
+  return waitchild(status, 0, 0);
+}
+
 void
 priority(int priority)
 {
-    if(current_policy == PRIORITY) {
+    if(current_policy == PRIORITY || current_policy == STRIDE) {
+        acquire(&ptable.lock);
         proc->priority = priority;
+        settickets(proc, priority);
+        release(&ptable.lock);
     } else {
         cprintf("Trying to change priority when policy is [%d]\n", current_policy);
     }
@@ -316,17 +730,22 @@ policy(int policy_num)
     switch (policy_num) {
         case UNIFORM:
             for(p = ptable.proc; p < &ptable.proc[NPROC]; p++) {
-                p->ntickets = 1;
+                settickets(p, 1);
             }
             break;
         case PRIORITY:
             for(p = ptable.proc; p < &ptable.proc[NPROC]; p++) {
-                p->ntickets = p->priority;
+                settickets(p, p->priority);
             }
             break;
         case DYNAMIC:
             for(p = ptable.proc; p < &ptable.proc[NPROC]; p++) {
-                p->ntickets = p->priority;
+                settickets(p, p->priority);
+            }
+            break;
+        case STRIDE:
+            for(p = ptable.proc; p < &ptable.proc[NPROC]; p++) {
+                settickets(p, p->priority);
             }
             break;
         default:
@@ -336,78 +755,16 @@ policy(int policy_num)
     release(&ptable.lock);
 }
 
- int
- wait_stat(int* status, struct perf* performance)
- {
-      struct proc *p;
-      int havekids, pid;
-
-      acquire(&ptable.lock);
-      for(;;) {
-        // Scan through table looking for exited children.
-        havekids = 0;
-        for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-          if(p->parent != proc)
-            continue;
-          havekids = 1;
-          if(p->state == ZOMBIE){
-            // Found one.
-            pid = p->pid;
-            kfree(p->kstack);
-            p->kstack = 0;
-            freevm(p->pgdir);
-            p->pid = 0;
-            p->parent = 0;
-            p->name[0] = 0;
-            p->killed = 0;
-            p->state = UNUSED;
-            performance->ctime = p->ctime;
-            performance->ttime = p->ttime;
-            performance->stime = p->stime;
-            performance->retime = p->retime;
-            performance->rutime = p->rutime;
-            if(status) {
-                *status = p->exit_status;
-            }
-            release(&ptable.lock);
-            return pid;
-          }
-        }
-
-        // No point waiting if we don't have any children.
-        if(!havekids || proc->killed){
-          release(&ptable.lock);
-          return -1;
-        }
-
-        // Wait for children to exit.  (See wakeup1 call in proc_exit.)
-        sleep(proc, &ptable.lock);  //DOC: wait-sleep
-      }
-}
-
-// update the performance metrics on every clock tick
-void
-update_performance(void)
+int
+wait_stat(int* status, struct perf* performance)
 {
-  struct proc *p ;
-  acquire(&ptable.lock);
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++) {
-      if(p->state == SLEEPING) {
-          p->stime++;
-      }
-      if(p->state == RUNNABLE) {
-          p->retime++;
-      }
-      if(p->state== RUNNING) {
-          p->rutime++;
-      }
-  }
-  release(&ptable.lock);
+  return waitchild(status, performance, 0);
 }
 
-uint generate_random_ticket(uint tick, uint sum)
+int
+wait_tstat(int* status, struct tperf* performance)
 {
-    return ((tick * 212344L + 1234123L) % sum);
+  return waitchild(status, 0, performance);
 }
 
  //PAGEBREAK: 42
@@ -422,50 +779,38 @@ void
 scheduler(void)
 {
   struct proc *p;
+  int c;
 
+  c = cpu - cpus;
   for(;;) {
     // Enable interrupts on this processor.
     sti();
 
-    // Loop over process table and calculate the total number of tickets
-    acquire(&ptable.lock);
-    uint winning_ticket = -1;
-    uint total_tickets_num = 0;
-    for(p = ptable.proc; p < &ptable.proc[NPROC]; p++) {
-      if(p->state == RUNNABLE) {
-          total_tickets_num += p->ntickets;
-      }
-    }
-
-    // draw the winning ticket pseudo randomly
-    if(total_tickets_num > 0) {
-        winning_ticket = generate_random_ticket(ticks, total_tickets_num);
+    // Draw from this CPU's run queue, or steal from the busiest
+    // peer if it is empty. Neither needs ptable.lock.
+    // With nothing to run, zero a page for kalloc_zeroed() meanwhile.
+    if((p = rq_pick(&runqs[c], c)) == 0 && (p = rq_steal(c)) == 0){
+      kzeroidle();
+      continue;
     }
 
-    // loop over the process table again, find the process the winning ticket
-    // belongs to and switch to it
-    int temp = winning_ticket;
-    for(p = ptable.proc; p < &ptable.proc[NPROC]; p++) {
-      if (p->state == RUNNABLE) {
-        temp -= p->ntickets;
-        if(temp < 0) {
-
-        // Switch to chosen process.  It is the process's job
-        // to release ptable.lock and then reacquire it
-        // before jumping back to us.
-        proc = p;
-        switchuvm(p);
-        p->state = RUNNING;
-        swtch(&cpu->scheduler, p->context);
-        switchkvm();
-
-        // Process is done running for now.
-        // It should have changed its p->state before coming back.
-        proc = 0;
-        break;
-        }
-      }
-    }
+    // Switch to chosen process.  It is the process's job
+    // to release ptable.lock and then reacquire it
+    // before jumping back to us.
+    acquire(&ptable.lock);
+    if(p->lastcpu >= 0 && p->lastcpu != c)
+      p->migrations++;
+    p->lastcpu = c;
+    proc = p;
+    switchuvm(p);
+    setstate(p, RUNNING);
+    p->qstart = lapictimer();
+    swtch(&cpu->scheduler, p->context);
+    switchkvm();
+
+    // Process is done running for now.
+    // It should have changed its p->state before coming back.
+    proc = 0;
     release(&ptable.lock);
   }
 }
@@ -495,17 +840,35 @@ sched(void)
   cpu->intena = intena;
 }
 
+// DYNAMIC policy: compensation tickets. A process that gives up the
+// CPU after using only a fraction f of its quantum holds priority/f
+// tickets until it runs again, which gives I/O-bound processes close
+// to round-robin latency. The boost is recomputed every time the
+// process leaves the CPU, so it expires after one run.
+static int
+compensate(struct proc *p)
+{
+  uint now, pct;
+
+  now = lapictimer();
+  if(p->qstart == 0 || now > p->qstart)
+    return p->priority;  // no lapic timer, or the quantum ran out
+  pct = (p->qstart - now) * 100 / QUANTUM;
+  if(pct < 1)
+    pct = 1;
+  return p->priority * 100 / pct;
+}
+
 // Give up the CPU for one scheduling round.
 void
 yield(void)
 {
   acquire(&ptable.lock);  //DOC: yieldlock
-  proc->state = RUNNABLE;
-  // the process ended the quanta without a blocking system call. punish it by
-  // reducing 1 ticket
-  if(current_policy == DYNAMIC && proc->ntickets > 1) {
-      proc->ntickets--;
+  // the process used its whole quantum, so any compensation expires
+  if(current_policy == DYNAMIC) {
+      settickets(proc, proc->priority);
   }
+  setstate(proc, RUNNABLE);
   sched();
   release(&ptable.lock);
 }
@@ -554,8 +917,13 @@ sleep(void *chan, struct spinlock *lk)
   }
 
   // Go to sleep.
+  // the process blocked before its quantum ended. compensate it for
+  // the unused part until it next runs
+  if(current_policy == DYNAMIC) {
+      settickets(proc, compensate(proc));
+  }
   proc->chan = chan;
-  proc->state = SLEEPING;
+  setstate(proc, SLEEPING);
   sched();
 
   // Tidy up.
@@ -578,14 +946,7 @@ wakeup1(void *chan)
 
   for(p = ptable.proc; p < &ptable.proc[NPROC]; p++) {
     if(p->state == SLEEPING && p->chan == chan) {
-      p->state = RUNNABLE;
-      // the process returned from a blocking system call. reward it with 10 tickets
-      if(current_policy == DYNAMIC) {
-          p->ntickets += 10;
-          if(p->ntickets > 100) {
-              p->ntickets = 100;
-          }
-      }
+      setstate(p, RUNNABLE);
     }
   }
 }
@@ -613,7 +974,44 @@ kill(int pid)
       p->killed = 1;
       // Wake process from sleep if necessary.
       if(p->state == SLEEPING)
-        p->state = RUNNABLE;
+        setstate(p, RUNNABLE);
+      release(&ptable.lock);
+      return 0;
+    }
+  }
+  release(&ptable.lock);
+  return -1;
+}
+
+// Restrict the process with the given pid to the CPUs in mask.
+// A queued process moves to an allowed CPU's queue right away,
+// a running one when it is next rescheduled.
+int
+setaffinity(int pid, uint mask)
+{
+  struct proc *p;
+  struct runq *rq;
+  int n;
+
+  if(ncpu < 32)
+    mask &= (1U << ncpu) - 1;
+  if(mask == 0)
+    return -1;
+
+  acquire(&ptable.lock);
+  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
+    if(p->pid == pid && p->state != UNUSED){
+      p->affinity = mask;
+      if((n = p->rq) >= 0 && !(mask & (1U << n))){
+        rq = &runqs[n];
+        acquire(&rq->lock);
+        if(p->rq == n){
+          rq_dequeue(rq, p);
+          release(&rq->lock);
+          rq_enqueue(p);
+        } else
+          release(&rq->lock);
+      }
       release(&ptable.lock);
       return 0;
     }
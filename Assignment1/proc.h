@@ -65,12 +65,25 @@ struct proc {
   char name[16];               // Process name (debugging)
   int exit_status;             // exit status. 0 means everything is ok. any other number means error
   int ntickets;                // number of tickets
+  int rq;                      // run queue holding this process, or -1
+  int hidx;                    // index in its run queue's heap
+  uint stride;                 // STRIDE1 / ntickets
+  uint pass;                   // stride scheduling virtual time
+  int lastcpu;                 // CPU it last ran on, or -1
+  uint affinity;               // bitmask of CPUs it may run on
+  int migrations;              // times it ran on a different CPU than before
+  uint qstart;                 // lapictimer() when last dispatched
   int priority;                // the process priopity
   int ctime;                   // creation time
   int ttime;                   // termination ttime
   int stime;                   // time spent in SLEEPING state
   int retime;                  // time spent in READY state
   int rutime;                  // time spent in RUNNING state
+  uint stamp;                  // ticks at the last state change
+  uint64 tstime;               // TSC cycles spent in SLEEPING state
+  uint64 tretime;              // TSC cycles spent in READY state
+  uint64 trutime;              // TSC cycles spent in RUNNING state
+  uint64 tstamp;               // TSC at the last state change
 };
 
 // Process memory is laid out contiguously, low addresses first:
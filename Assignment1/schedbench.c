@@ -0,0 +1,374 @@
+// schedbench: scheduler benchmark suite.
+// Runs a workload of njobs child processes under each of the
+// UNIFORM, PRIORITY, DYNAMIC and STRIDE policies and reports, per policy:
+//   - throughput, in jobs completed per second
+//   - mean completion time and running time per job
+//   - Jain's fairness index over the jobs' running times
+//   - p50/p99 wakeup latency, from the schedtrace device
+//   - CPU migrations per job
+//
+//   schedbench [cpu|sleep|mixed|pipe|fork|all] [njobs]
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "fcntl.h"
+#include "param.h"
+#include "perf.h"
+#include "schedtrace.h"
+
+// enum procstate values from proc.h
+#define SLEEPING 2
+#define RUNNABLE 3
+#define RUNNING 4
+
+#define SCHEDTRACE 2   // device major, see file.h
+#define HZ 100         // approximate timer ticks per second under qemu
+#define NSLOT 64       // pending wakeups, keyed by pid % NSLOT
+#define NSAMPLE 4096
+#define TICKWORK 1000000 // loop iterations, roughly a tick of CPU under qemu
+
+char *polname[] = { 0, "UNIFORM", "PRIORITY", "DYNAMIC", "STRIDE" };
+#define NPOLICY 4
+
+struct workload {
+  char *name;
+  void (*job)(int, int*);
+};
+
+//PAGEBREAK!
+// Workloads. Each job runs in its own child process;
+// i is the job number, fds the job's pipe for "pipe".
+
+// Burn a fixed amount of CPU, about nticks ticks' worth when
+// the job has a CPU to itself. Unlike waiting for uptime() to
+// advance, the job takes longer when the scheduler runs it less.
+void
+work(int nticks)
+{
+  volatile int x;
+  int i;
+
+  x = 0;
+  for(i = 0; i < nticks * TICKWORK; i++)
+    x += i;
+}
+
+void
+cpujob(int i, int *fds)
+{
+  work(20);
+}
+
+void
+sleepjob(int i, int *fds)
+{
+  int j;
+
+  for(j = 0; j < 20; j++)
+    sleep(1);
+}
+
+void
+mixedjob(int i, int *fds)
+{
+  int j;
+
+  for(j = 0; j < 5; j++){
+    work(4);
+    sleep(1);
+  }
+}
+
+// Jobs 2k and 2k+1 bounce a byte over the pipe pair in fds.
+// An unpaired last job sees EOF right away.
+void
+pipejob(int i, int *fds)
+{
+  int j, rfd, wfd;
+  char c;
+
+  if(i % 2 == 0){
+    rfd = fds[0];
+    wfd = fds[3];
+    close(fds[1]);
+    close(fds[2]);
+  } else {
+    rfd = fds[2];
+    wfd = fds[1];
+    close(fds[0]);
+    close(fds[3]);
+  }
+  c = 0;
+  if(i % 2 == 0)
+    write(wfd, &c, 1);
+  for(j = 0; j < 500; j++){
+    if(read(rfd, &c, 1) != 1)
+      break;
+    if(write(wfd, &c, 1) != 1)
+      break;
+  }
+}
+
+void
+forkjob(int i, int *fds)
+{
+  int j, pid;
+
+  for(j = 0; j < 20; j++){
+    if((pid = fork()) == 0)
+      exit(0);
+    if(pid > 0)
+      wait(0);
+  }
+}
+
+struct workload workloads[] = {
+  { "cpu", cpujob },
+  { "sleep", sleepjob },
+  { "mixed", mixedjob },
+  { "pipe", pipejob },
+  { "fork", forkjob },
+};
+
+#define NWORKLOAD (sizeof(workloads)/sizeof(workloads[0]))
+
+//PAGEBREAK!
+// Wakeup latency collector. Runs in its own process, started
+// before the run's jobs. The parent writes marker mark before
+// forking the jobs and mark+1 after they finish; the collector
+// skips events up to the first, left over from earlier runs,
+// reads until the second, then sends nsample, p50 and p99
+// (microseconds) back over a pipe.
+
+struct {
+  int pid;
+  uint time;
+} woken[NSLOT];
+
+uint samples[NSAMPLE];
+struct schedevent ev[64];
+
+void
+sort(uint *a, int n)
+{
+  int gap, i, j;
+  uint t;
+
+  for(gap = n/2; gap > 0; gap /= 2)
+    for(i = gap; i < n; i++)
+      for(j = i - gap; j >= 0 && a[j] > a[j+gap]; j -= gap){
+        t = a[j];
+        a[j] = a[j+gap];
+        a[j+gap] = t;
+      }
+}
+
+void
+collect(int tfd, int outfd, int ppid, int mark)
+{
+  int n, i, nsample, self, started, done, res[3];
+  struct schedevent *e;
+
+  self = getpid();
+  nsample = 0;
+  memset(woken, 0, sizeof(woken));
+  started = 0;
+  for(done = 0; !done; ){
+    if((n = read(tfd, ev, sizeof(ev))) <= 0)
+      break;
+    for(e = ev; e < &ev[n / sizeof(ev[0])]; e++){
+      if(e->pid == ppid && e->from == SCHEDMARK){
+        if(e->ticket == mark)
+          started = 1;
+        else if(started && e->ticket == mark + 1){
+          done = 1;
+          break;
+        }
+        continue;
+      }
+      if(!started || e->pid == ppid || e->pid == self)
+        continue;
+      i = e->pid % NSLOT;
+      if(e->from == SLEEPING && e->to == RUNNABLE){
+        woken[i].pid = e->pid;
+        woken[i].time = e->time;
+      } else if(e->to == RUNNING && woken[i].pid == e->pid){
+        if(nsample < NSAMPLE)
+          samples[nsample++] = e->time - woken[i].time;
+        woken[i].pid = 0;
+      }
+    }
+  }
+  sort(samples, nsample);
+  res[0] = nsample;
+  res[1] = nsample ? samples[nsample/2] : 0;
+  res[2] = nsample ? samples[nsample*99/100] : 0;
+  write(outfd, res, sizeof(res));
+  exit(0);
+}
+
+//PAGEBREAK!
+// Jain's fairness index (sum x)^2 / (n * sum x^2), times 1000,
+// computed as mean^2 / mean(x^2) to stay within 32 bits.
+// The index does not depend on the unit of x, so x is scaled
+// down to 12 bits first; n is at most NPROC, so sum x^2 fits.
+int
+jain(uint *x, int n)
+{
+  uint sum, sumsq, mean, meansq, max, v;
+  int i, shift;
+
+  if(n == 0)
+    return 1000;
+  max = 0;
+  for(i = 0; i < n; i++)
+    if(x[i] > max)
+      max = x[i];
+  for(shift = 0; (max >> shift) >= 4096; shift++)
+    ;
+  sum = sumsq = 0;
+  for(i = 0; i < n; i++){
+    v = x[i] >> shift;
+    sum += v;
+    sumsq += v * v;
+  }
+  mean = sum / n;
+  meansq = sumsq / n;
+  if(meansq == 0)
+    return 1000;
+  if(mean * mean < 4000000)
+    return mean * mean * 1000 / meansq;
+  return mean * mean / (meansq / 1000);
+}
+
+// Print v/1000 with three decimals.
+void
+printfrac(int v)
+{
+  printf(1, "%d.%d%d%d", v / 1000, v / 100 % 10, v / 10 % 10, v % 10);
+}
+
+uint runus[NSAMPLE];
+
+void
+run(struct workload *w, int pol, int njobs, int tfd)
+{
+  static int nrun;
+  int i, pid, rpid, ppid, start, elapsed, done, mark, paired, res[3], migr;
+  uint turnus, runsum;
+  int fds[4], out[2];
+  struct tperf perf;
+
+  policy(pol);
+  ppid = getpid();
+
+  // Start the collector first, so it is already reading the
+  // trace while the jobs run.
+  mark = 2 * nrun++;
+  if(pipe(out) < 0 || (rpid = fork()) < 0){
+    printf(2, "schedbench: cannot start collector\n");
+    exit(-1);
+  }
+  if(rpid == 0){
+    close(out[0]);
+    collect(tfd, out[1], ppid, mark);
+  }
+  close(out[1]);
+  while(write(tfd, &mark, sizeof(mark)) < 0)
+    sleep(1);
+
+  start = uptime();
+  paired = w->job == pipejob;
+  for(i = 0; i < njobs; i++){
+    if(paired && i % 2 == 0 && (pipe(fds) < 0 || pipe(fds+2) < 0)){
+      printf(2, "schedbench: pipe failed\n");
+      exit(-1);
+    }
+    if((pid = fork()) < 0){
+      printf(2, "schedbench: fork failed\n");
+      exit(-1);
+    }
+    if(pid == 0){
+      close(out[0]);
+      w->job(i, fds);
+      exit(0);
+    }
+    if(paired && (i % 2 == 1 || i == njobs - 1)){
+      close(fds[0]);
+      close(fds[1]);
+      close(fds[2]);
+      close(fds[3]);
+    }
+  }
+
+  migr = 0;
+  turnus = runsum = 0;
+  for(done = 0; done < njobs; ){
+    if((pid = wait_tstat(0, &perf)) < 0)
+      break;
+    if(pid == rpid)
+      continue;
+    runus[done++] = perf.rutime_us;
+    runsum += perf.rutime_us;
+    turnus += perf.stime_us + perf.retime_us + perf.rutime_us;
+    migr += perf.migrations;
+  }
+  elapsed = uptime() - start;
+  if(elapsed < 1)
+    elapsed = 1;
+
+  // Let the collector drain the rings, then tell it to stop.
+  sleep(2);
+  mark++;
+  while(write(tfd, &mark, sizeof(mark)) < 0)
+    sleep(1);
+  if(read(out[0], res, sizeof(res)) != sizeof(res))
+    res[0] = res[1] = res[2] = 0;
+  close(out[0]);
+  wait(0);
+
+  printf(1, "%s\t%s\tthroughput ", w->name, polname[pol]);
+  printfrac(njobs * HZ * 1000 / elapsed);
+  printf(1, " jobs/s  completion ");
+  printfrac(done ? turnus / done : 0);
+  printf(1, "ms  running ");
+  printfrac(done ? runsum / done : 0);
+  printf(1, "ms  fairness ");
+  printfrac(jain(runus, done));
+  printf(1, "  wakeups %d p50 %dus p99 %dus", res[0], res[1], res[2]);
+  printf(1, "  migrations/job ");
+  printfrac(done ? migr * 1000 / done : 0);
+  printf(1, "\n");
+}
+
+int
+main(int argc, char *argv[])
+{
+  int i, pol, njobs, tfd;
+  char *which;
+
+  which = argc > 1 ? argv[1] : "all";
+  njobs = argc > 2 ? atoi(argv[2]) : 30;
+  if(njobs < 2 || njobs > NPROC - 8){
+    printf(2, "usage: schedbench [cpu|sleep|mixed|pipe|fork|all] [njobs]\n");
+    exit(-1);
+  }
+  if((tfd = open("schedtrace", O_RDWR)) < 0){
+    mknod("schedtrace", SCHEDTRACE, 0);
+    if((tfd = open("schedtrace", O_RDWR)) < 0){
+      printf(2, "schedbench: cannot open schedtrace\n");
+      exit(-1);
+    }
+  }
+
+  for(i = 0; i < NWORKLOAD; i++){
+    if(strcmp(which, "all") != 0 && strcmp(which, workloads[i].name) != 0)
+      continue;
+    for(pol = 1; pol <= NPOLICY; pol++)
+      run(&workloads[i], pol, njobs, tfd);
+  }
+  policy(1);
+  close(tfd);
+  exit(0);
+}
@@ -0,0 +1,129 @@
+// schedlat: run a command and report the wakeup latency of all
+// processes while it runs, from the scheduler trace device.
+// Latency is the time from a SLEEPING -> RUNNABLE transition to
+// the process next being dispatched.
+//
+//   schedlat sanity
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "fcntl.h"
+#include "schedtrace.h"
+
+// enum procstate values from proc.h
+#define SLEEPING 2
+#define RUNNABLE 3
+#define RUNNING 4
+
+#define SCHEDTRACE 2   // device major, see file.h
+#define NSLOT 64       // pending wakeups, keyed by pid % NSLOT
+#define NSAMPLE 4096
+
+struct {
+  int pid;
+  uint time;
+} woken[NSLOT];
+
+uint samples[NSAMPLE];
+int nsample;
+struct schedevent ev[64];
+
+void
+sort(uint *a, int n)
+{
+  int gap, i, j;
+  uint t;
+
+  for(gap = n/2; gap > 0; gap /= 2)
+    for(i = gap; i < n; i++)
+      for(j = i - gap; j >= 0 && a[j] > a[j+gap]; j -= gap){
+        t = a[j];
+        a[j] = a[j+gap];
+        a[j+gap] = t;
+      }
+}
+
+// Read the trace until the marker written by ppid, then print
+// the latency distribution of everyone but ppid and ourselves.
+void
+collect(int fd, int ppid)
+{
+  int n, i, self, done;
+  struct schedevent *e;
+
+  self = getpid();
+  for(done = 0; !done; ){
+    if((n = read(fd, ev, sizeof(ev))) <= 0)
+      break;
+    for(e = ev; e < &ev[n / sizeof(ev[0])]; e++){
+      if(e->pid == ppid && e->from == SCHEDMARK){
+        done = 1;
+        break;
+      }
+      if(e->pid == ppid || e->pid == self)
+        continue;
+      i = e->pid % NSLOT;
+      if(e->from == SLEEPING && e->to == RUNNABLE){
+        woken[i].pid = e->pid;
+        woken[i].time = e->time;
+      } else if(e->to == RUNNING && woken[i].pid == e->pid){
+        if(nsample < NSAMPLE)
+          samples[nsample++] = e->time - woken[i].time;
+        woken[i].pid = 0;
+      }
+    }
+  }
+
+  if(nsample == 0){
+    printf(1, "schedlat: no wakeups traced\n");
+    exit(0);
+  }
+  sort(samples, nsample);
+  printf(1, "schedlat: %d wakeups, latency us: p50 %d p90 %d p99 %d max %d\n",
+         nsample, samples[nsample/2], samples[nsample*9/10],
+         samples[nsample*99/100], samples[nsample-1]);
+  exit(0);
+}
+
+int
+main(int argc, char *argv[])
+{
+  int fd, pid, rpid, ppid, mark, w;
+
+  if(argc < 2){
+    printf(2, "usage: schedlat command [args...]\n");
+    exit(-1);
+  }
+  if((fd = open("schedtrace", O_RDWR)) < 0){
+    mknod("schedtrace", SCHEDTRACE, 0);
+    if((fd = open("schedtrace", O_RDWR)) < 0){
+      printf(2, "schedlat: cannot open schedtrace\n");
+      exit(-1);
+    }
+  }
+  read(fd, ev, sizeof(ev));  // discard events from before the run
+
+  // The collector stops at our marker rather than at the command's
+  // exit, whose event may be dropped if a ring is full.
+  ppid = getpid();
+  if((rpid = fork()) == 0)
+    collect(fd, ppid);
+  if((pid = fork()) == 0){
+    close(fd);
+    exec(argv[1], argv+1);
+    printf(2, "schedlat: exec %s failed\n", argv[1]);
+    exit(-1);
+  }
+  while((w = wait(0)) >= 0 && w != pid)
+    ;
+
+  sleep(2);
+  mark = 0;
+  while(write(fd, &mark, sizeof(mark)) < 0)
+    sleep(1);
+  if(rpid > 0)
+    wait(0);
+  close(fd);
+  exit(0);
+}
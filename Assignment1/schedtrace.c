@@ -0,0 +1,126 @@
+// Scheduler trace: per-CPU rings of scheduling events,
+// read by streaming read() on the SCHEDTRACE device.
+// A write() to the device records a SCHEDMARK event, which
+// lets a program delimit the part of the trace it cares about.
+//
+// A ring is only written by its own CPU, and always with
+// interrupts off (under ptable.lock or a run queue lock),
+// so recording takes no lock. Readers are serialized by
+// trace.lock. When a ring is full new events are dropped.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "mmu.h"
+#include "x86.h"
+#include "proc.h"
+#include "spinlock.h"
+#include "sleeplock.h"
+#include "fs.h"
+#include "file.h"
+#include "schedtrace.h"
+
+#define NTRACE 256  // events per CPU
+
+struct ring {
+  struct schedevent ev[NTRACE];
+  volatile uint head;  // next slot to fill; only the owning CPU writes it
+  volatile uint tail;  // next slot to read; only readers write it
+};
+
+static struct {
+  struct spinlock lock;
+  struct ring ring[NCPU];
+} trace;
+
+// Record that p went from state from to state to.
+// ticket and total describe the draw when p was dispatched.
+// Must be called with interrupts off.
+// Returns -1 if the event was dropped.
+int
+schedtrace(struct proc *p, int from, int to, uint ticket, uint total)
+{
+  struct ring *r;
+  struct schedevent *e;
+
+  r = &trace.ring[cpu - cpus];
+  if(r->head - r->tail >= NTRACE)
+    return -1;
+  e = &r->ev[r->head % NTRACE];
+  e->time = tsc2us(rdtsc());
+  e->pid = p->pid;
+  e->ticket = ticket;
+  e->total = total;
+  e->cpu = cpu - cpus;
+  e->from = from;
+  e->to = to;
+  e->pad = 0;
+  __sync_synchronize();  // publish the event before moving head
+  r->head++;
+  return 0;
+}
+
+// Copy out as many whole events as fit in n bytes, waiting
+// a tick at a time until there is at least one.
+static int
+schedtraceread(struct inode *ip, char *dst, int n)
+{
+  struct ring *r;
+  int got;
+
+  iunlock(ip);
+  acquire(&trace.lock);
+  got = 0;
+  while(n >= sizeof(struct schedevent)){
+    for(r = trace.ring; r < &trace.ring[ncpu]; r++){
+      while(r->tail != r->head && n - got >= sizeof(struct schedevent)){
+        __sync_synchronize();  // read the event after seeing head
+        memmove(dst + got, &r->ev[r->tail % NTRACE], sizeof(struct schedevent));
+        r->tail++;
+        got += sizeof(struct schedevent);
+      }
+    }
+    if(got > 0)
+      break;
+    if(proc->killed){
+      release(&trace.lock);
+      ilock(ip);
+      return -1;
+    }
+    // Producers hold ptable.lock, so they cannot wake us;
+    // poll once per tick instead.
+    release(&trace.lock);
+    acquire(&tickslock);
+    sleep(&ticks, &tickslock);
+    release(&tickslock);
+    acquire(&trace.lock);
+  }
+  release(&trace.lock);
+  ilock(ip);
+  return got;
+}
+
+// Record a marker event for the writing process. The first
+// word written, if any, is stored in the event's ticket field.
+static int
+schedtracewrite(struct inode *ip, char *src, int n)
+{
+  uint val;
+  int r;
+
+  val = 0;
+  if(n >= sizeof(val))
+    memmove(&val, src, sizeof(val));
+  pushcli();
+  r = schedtrace(proc, SCHEDMARK, SCHEDMARK, val, 0);
+  popcli();
+  return r < 0 ? -1 : n;
+}
+
+void
+schedtraceinit(void)
+{
+  initlock(&trace.lock, "schedtrace");
+  devsw[SCHEDTRACE].read = schedtraceread;
+  devsw[SCHEDTRACE].write = schedtracewrite;
+}
@@ -0,0 +1,15 @@
+// Scheduling event, as read from the schedtrace device.
+// from and to are enum procstate values (see proc.h), or both
+// SCHEDMARK for a marker written to the device by a process.
+struct schedevent {
+  uint time;        // microseconds since boot, from the TSC
+  int pid;
+  uint ticket;      // winning ticket (pass under STRIDE), when to is RUNNING
+  uint total;       // tickets in the draw, when to is RUNNING
+  uchar cpu;
+  uchar from;       // old state
+  uchar to;         // new state
+  uchar pad;
+};
+
+#define SCHEDMARK 0xff
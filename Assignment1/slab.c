@@ -0,0 +1,188 @@
+// Slab allocator for small kernel objects, on top of kalloc().
+// A cache hands out objects of one size. Each slab is one page
+// holding a struct slab header and then the objects; free objects
+// are chained through their first word. Slabs with free objects
+// are on the cache's partial list. A slab whose objects are all
+// free goes back to kalloc() unless it is the only partial slab.
+//
+// As with kalloc()'s magazines, each CPU keeps a small stack of
+// free objects per cache, used with interrupts off, and only takes
+// the cache lock to move CPUBATCH objects to or from the slabs.
+// Objects are not zeroed.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "mmu.h"
+#include "proc.h"
+#include "spinlock.h"
+
+#define NCACHE 8     // max number of caches
+#define CPUCACHE 16  // max objects in a per-CPU cache
+#define CPUBATCH 8   // objects moved to or from the slabs at once
+
+struct slab {
+  struct kmem_cache *cache;
+  struct slab *next;    // partial list
+  struct slab *prev;
+  void *free;           // free objects in this slab
+  int inuse;
+};
+
+struct cpucache {
+  int n;
+  void *obj[CPUCACHE];
+} __attribute__((aligned(64)));
+
+struct kmem_cache {
+  char *name;
+  uint size;            // object size, rounded up to a multiple of 4
+  uint perslab;         // objects per slab
+  struct spinlock lock;
+  struct slab *partial; // slabs with free objects
+  struct cpucache cpu[NCPU];
+};
+
+// Caches are only created during boot, one at a time,
+// so the table needs no lock.
+static struct {
+  struct kmem_cache cache[NCACHE];
+  int n;
+} slabs;
+
+// Make a cache of objects of the given size.
+struct kmem_cache*
+kmem_cache_create(char *name, uint size)
+{
+  struct kmem_cache *c;
+
+  if(slabs.n == NCACHE)
+    panic("kmem_cache_create: no caches");
+  c = &slabs.cache[slabs.n++];
+  c->name = name;
+  c->size = (size + 3) & ~3;  // room and alignment for the free link
+  c->perslab = (PGSIZE - sizeof(struct slab)) / c->size;
+  if(c->perslab == 0)
+    panic("kmem_cache_create: too big");
+  initlock(&c->lock, name);
+  return c;
+}
+
+static void
+slab_link(struct kmem_cache *c, struct slab *s)
+{
+  s->prev = 0;
+  s->next = c->partial;
+  if(c->partial)
+    c->partial->prev = s;
+  c->partial = s;
+}
+
+static void
+slab_unlink(struct kmem_cache *c, struct slab *s)
+{
+  if(s->prev)
+    s->prev->next = s->next;
+  else
+    c->partial = s->next;
+  if(s->next)
+    s->next->prev = s->prev;
+}
+
+// Carve a new page into free objects and put it on c's
+// partial list. Caller must hold c->lock.
+static struct slab*
+slab_grow(struct kmem_cache *c)
+{
+  struct slab *s;
+  char *o;
+  int i;
+
+  if((s = (struct slab*)kalloc()) == 0)
+    return 0;
+  s->cache = c;
+  s->free = 0;
+  s->inuse = 0;
+  o = (char*)(s + 1);
+  for(i = 0; i < c->perslab; i++, o += c->size){
+    *(void**)o = s->free;
+    s->free = o;
+  }
+  slab_link(c, s);
+  return s;
+}
+
+// Take a free object from c's slabs. Caller must hold c->lock.
+static void*
+slab_get(struct kmem_cache *c)
+{
+  struct slab *s;
+  void *o;
+
+  if((s = c->partial) == 0 && (s = slab_grow(c)) == 0)
+    return 0;
+  o = s->free;
+  s->free = *(void**)o;
+  if(++s->inuse == c->perslab)
+    slab_unlink(c, s);
+  return o;
+}
+
+// Return object o to its slab. Caller must hold c->lock.
+static void
+slab_put(struct kmem_cache *c, void *o)
+{
+  struct slab *s;
+
+  s = (struct slab*)PGROUNDDOWN((uint)o);
+  if(s->inuse-- == c->perslab)
+    slab_link(c, s);
+  *(void**)o = s->free;
+  s->free = o;
+  if(s->inuse == 0 && (s->prev || s->next)){
+    slab_unlink(c, s);
+    kfree((char*)s);
+  }
+}
+
+// Allocate an object from c.
+// Returns 0 if the memory cannot be allocated.
+void*
+kmem_cache_alloc(struct kmem_cache *c)
+{
+  struct cpucache *cc;
+  void *o;
+
+  pushcli();
+  cc = &c->cpu[cpu - cpus];
+  if(cc->n == 0){
+    acquire(&c->lock);
+    while(cc->n < CPUBATCH && (o = slab_get(c)) != 0)
+      cc->obj[cc->n++] = o;
+    release(&c->lock);
+  }
+  o = cc->n > 0 ? cc->obj[--cc->n] : 0;
+  popcli();
+  return o;
+}
+
+// Free object o, which must have come from kmem_cache_alloc(c).
+void
+kmem_cache_free(struct kmem_cache *c, void *o)
+{
+  struct cpucache *cc;
+
+  if(((struct slab*)PGROUNDDOWN((uint)o))->cache != c)
+    panic("kmem_cache_free");
+
+  pushcli();
+  cc = &c->cpu[cpu - cpus];
+  if(cc->n == CPUCACHE){
+    acquire(&c->lock);
+    while(cc->n > CPUCACHE - CPUBATCH)
+      slab_put(c, cc->obj[--cc->n]);
+    release(&c->lock);
+  }
+  cc->obj[cc->n++] = o;
+  popcli();
+}
@@ -19,12 +19,15 @@ fetchint(uint addr, int *ip)
 {
   if(addr >= proc->sz || addr+4 > proc->sz)
     return -1;
+  if(uvmpopulate(proc->pgdir, addr, 4) < 0)
+    return -1;
   *ip = *(int*)(addr);
   return 0;
 }
 
 // Fetch the nul-terminated string at addr from the current process.
 // Doesn't actually copy the string - just sets *pp to point at it.
+// Maps each page of it that sbrk() has not allocated yet.
 // Returns length of string, not including nul.
 int
 fetchstr(uint addr, char **pp)
@@ -35,9 +38,13 @@ fetchstr(uint addr, char **pp)
     return -1;
   *pp = (char*)addr;
   ep = (char*)proc->sz;
-  for(s = *pp; s < ep; s++)
+  for(s = *pp; s < ep; s++){
+    if((s == *pp || (uint)s % PGSIZE == 0) &&
+       uvmpopulate(proc->pgdir, (uint)s, 1) < 0)
+      return -1;
     if(*s == 0)
       return s - *pp;
+  }
   return -1;
 }
 
@@ -50,7 +57,9 @@ argint(int n, int *ip)
 
 // Fetch the nth word-sized system call argument as a pointer
 // to a block of memory of size bytes.  Check that the pointer
-// lies within the process address space.
+// lies within the process address space, and make all of it
+// present and writable now: the kernel may write the buffer
+// while holding locks, where it cannot handle a fault.
 int
 argptr(int n, char **pp, int size)
 {
@@ -60,6 +69,8 @@ argptr(int n, char **pp, int size)
     return -1;
   if(size < 0 || (uint)i >= proc->sz || (uint)i+size > proc->sz)
     return -1;
+  if(uvmwritable(proc->pgdir, i, size) < 0)
+    return -1;
   *pp = (char*)i;
   return 0;
 }
@@ -101,6 +112,10 @@ extern int sys_uptime(void);
 extern int sys_priority(void);
 extern int sys_policy(void);
 extern int sys_wait_stat(void);
+extern int sys_wait_tstat(void);
+extern int sys_setaffinity(void);
+extern int sys_sync(void);
+extern int sys_diskwrites(void);
 
 static int (*syscalls[])(void) = {
 [SYS_fork]    sys_fork,
@@ -126,7 +141,11 @@ static int (*syscalls[])(void) = {
 [SYS_close]   sys_close,
 [SYS_priority] sys_priority,
 [SYS_policy]  sys_policy,
-[SYS_wait_stat] sys_wait_stat
+[SYS_wait_stat] sys_wait_stat,
+[SYS_wait_tstat] sys_wait_tstat,
+[SYS_setaffinity] sys_setaffinity,
+[SYS_sync]    sys_sync,
+[SYS_diskwrites] sys_diskwrites,
 };
 
 void
@@ -23,3 +23,7 @@
 #define SYS_priority 22
 #define SYS_policy 23
 #define SYS_wait_stat 24
+#define SYS_wait_tstat 25
+#define SYS_setaffinity 26
+#define SYS_sync 27
+#define SYS_diskwrites 28
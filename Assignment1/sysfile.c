@@ -184,7 +184,6 @@ int
 sys_unlink(void)
 {
   struct inode *ip, *dp;
-  struct dirent de;
   char name[DIRSIZ], *path;
   uint off;
 
@@ -214,9 +213,7 @@ sys_unlink(void)
     goto bad;
   }
 
-  memset(&de, 0, sizeof(de));
-  if(writei(dp, (char*)&de, off, sizeof(de)) != sizeof(de))
-    panic("unlink: writei");
+  dirunlink(dp, name, off);
   if(ip->type == T_DIR){
     dp->nlink--;
     iupdate(dp);
@@ -441,3 +438,18 @@ sys_pipe(void)
   fd[1] = fd1;
   return 0;
 }
+
+// Write everything the log holds to its home location on disk.
+int
+sys_sync(void)
+{
+  log_sync();
+  return 0;
+}
+
+// Return the number of blocks written to disk since boot.
+int
+sys_diskwrites(void)
+{
+  return idewrites();
+}
@@ -6,6 +6,7 @@
 #include "memlayout.h"
 #include "mmu.h"
 #include "proc.h"
+#include "perf.h"
 
 int
 sys_fork(void)
@@ -26,7 +27,15 @@ int
 sys_wait(void)
 {
     int* status;
-    argptr(0, (char**) &status, sizeof(int*));
+    int addr;
+
+    // wait(0) discards the status, so there is no buffer to check.
+    if(argint(0, &addr) < 0)
+        return -1;
+    if(addr == 0)
+        status = 0;
+    else if(argptr(0, (char**) &status, sizeof(int)) < 0)
+        return -1;
     return wait(status);
 }
 
@@ -119,8 +128,29 @@ sys_wait_stat(void)
 {
     int* status;
     struct perf* performance;
-    if((argptr(0,(char**) &status ,sizeof(int*)) < 0) ||
-       (argptr(1,(char**) &performance ,sizeof(struct perf *)) < 0))
+    if((argptr(0,(char**) &status ,sizeof(int)) < 0) ||
+       (argptr(1,(char**) &performance ,sizeof(struct perf)) < 0))
             return -1;
     return wait_stat(status ,performance);
 }
+
+int
+sys_setaffinity(void)
+{
+  int pid, mask;
+
+  if(argint(0, &pid) < 0 || argint(1, &mask) < 0)
+    return -1;
+  return setaffinity(pid, mask);
+}
+
+int
+sys_wait_tstat(void)
+{
+    int* status;
+    struct tperf* performance;
+    if((argptr(0,(char**) &status ,sizeof(int)) < 0) ||
+       (argptr(1,(char**) &performance ,sizeof(struct tperf)) < 0))
+            return -1;
+    return wait_tstat(status ,performance);
+}
@@ -0,0 +1,23 @@
+// taskset: run a command restricted to a set of CPUs.
+// The mask is a decimal bitmask of CPU numbers, so
+//   taskset 1 schedbench cpu
+// keeps schedbench and everything it forks on CPU 0.
+
+#include "types.h"
+#include "user.h"
+
+int
+main(int argc, char *argv[])
+{
+  if(argc < 3){
+    printf(2, "usage: taskset mask command [args...]\n");
+    exit(-1);
+  }
+  if(setaffinity(getpid(), atoi(argv[1])) < 0){
+    printf(2, "taskset: bad mask %s\n", argv[1]);
+    exit(-1);
+  }
+  exec(argv[2], argv+2);
+  printf(2, "taskset: exec %s failed\n", argv[2]);
+  exit(-1);
+}
@@ -51,7 +51,6 @@ trap(struct trapframe *tf)
     if(cpunum() == 0){
       acquire(&tickslock);
       ticks++;
-      update_performance();
       wakeup(&ticks);
       release(&tickslock);
     }
@@ -79,6 +78,29 @@ trap(struct trapframe *tf)
     lapiceoi();
     break;
 
+  case T_PGFLT:
+    // A first touch of a lazily allocated heap page, or a write
+    // to a copy-on-write page, from user code or from the kernel
+    // using a user address.
+    if(proc && rcr2() < proc->sz){
+      if(!(tf->err & 1) && lazyfault(proc->pgdir, rcr2()) == 0)
+        break;
+      if((tf->err & 2) && cowfault(proc->pgdir, rcr2()) == 0)
+        break;
+      if((tf->cs&3) == 0){
+        // Out of memory. System calls map and unshare their user
+        // buffers up front and return -1 if they cannot (see
+        // argptr()), so this is not expected. Rather than panic,
+        // kill the process and retry the access, after giving
+        // other processes a chance to free memory if we can.
+        proc->killed = 1;
+        if(cpu->ncli == 0)
+          yield();
+        break;
+      }
+    }
+    // fall through
+
   //PAGEBREAK: 13
   default:
     if(proc == 0 || (tf->cs&3) == 0){
@@ -1,6 +1,7 @@
 struct stat;
 struct rtcdate;
 struct perf;
+struct tperf;
 // system calls
 int fork(void);
 void exit(int) __attribute__((noreturn));
@@ -26,6 +27,10 @@ int uptime(void);
 void priority(int);
 void policy(int);
 int wait_stat(int*, struct perf*);
+int wait_tstat(int*, struct tperf*);
+int setaffinity(int, uint);
+int sync(void);
+int diskwrites(void);
 // ulib.c
 int stat(char*, struct stat*);
 char* strcpy(char*, char*);
@@ -584,10 +584,12 @@ void
 createdelete(void)
 {
   enum { N = 20 };
-  int pid, i, fd, pi;
+  int pid, i, fd, pi, nw;
   char name[32];
 
   printf(1, "createdelete test\n");
+  sync();
+  nw = diskwrites();
 
   for(pi = 0; pi < 4; pi++){
     pid = fork();
@@ -622,6 +624,8 @@ createdelete(void)
   for(pi = 0; pi < 4; pi++){
     wait(0);
   }
+  sync();
+  printf(1, "createdelete: %d disk writes\n", diskwrites() - nw);
 
   name[0] = name[1] = name[2] = 0;
   for(i = 0; i < N; i++){
@@ -1411,6 +1415,135 @@ forktest(void)
   printf(1, "fork test OK\n");
 }
 
+// parent and child must not see each other's writes
+// to pages shared by copy-on-write fork.
+void
+cowtest(void)
+{
+  char *p;
+  int fds[2], pid, i;
+
+  printf(stdout, "cow test\n");
+  p = sbrk(3*4096);
+  for(i = 0; i < 3*4096; i++)
+    p[i] = 'a';
+  if(pipe(fds) != 0){
+    printf(stdout, "pipe() failed\n");
+    exit(0);
+  }
+  pid = fork();
+  if(pid < 0){
+    printf(stdout, "fork failed\n");
+    exit(0);
+  }
+  if(pid == 0){
+    for(i = 0; i < 4096; i += 100)
+      p[i] = 'b';
+    // read() copies out to the still shared second page from the kernel
+    if(read(fds[0], p + 4096, 1) != 1 || p[4096] != 'c' || p[0] != 'b'){
+      printf(stdout, "cow child saw wrong data\n");
+      exit(-1);
+    }
+    exit(0);
+  }
+  p[1] = 'p';
+  write(fds[1], "c", 1);
+  wait(&i);
+  if(i != 0 || p[0] != 'a' || p[1] != 'p' || p[4096] != 'a'){
+    printf(stdout, "cow parent saw wrong data\n");
+    exit(0);
+  }
+  close(fds[0]);
+  close(fds[1]);
+  sbrk(-3*4096);
+  printf(stdout, "cow test OK\n");
+}
+
+// sbrk() only reserves address space, so a heap much larger
+// than physical memory works as long as little of it is touched.
+void
+lazytest(void)
+{
+  char *p;
+  int fds[2], pid, i;
+  uint amt;
+
+  printf(stdout, "lazy sbrk test\n");
+  amt = 512*1024*1024;
+  p = sbrk(amt);
+  if(p == (char*)-1){
+    printf(stdout, "lazy sbrk of 512MB failed\n");
+    exit(0);
+  }
+  for(i = 0; i < 512; i++){
+    if(p[i*1024*1024 + 4095] != 0){
+      printf(stdout, "lazy page not zero\n");
+      exit(0);
+    }
+    p[i*1024*1024] = i;
+  }
+  // the kernel writes into an untouched page, and a fork
+  // copies an address space full of holes
+  if(pipe(fds) != 0){
+    printf(stdout, "pipe() failed\n");
+    exit(0);
+  }
+  pid = fork();
+  if(pid < 0){
+    printf(stdout, "fork failed\n");
+    exit(0);
+  }
+  if(pid == 0){
+    write(fds[1], "x", 1);
+    exit(p[100*1024*1024] == 100 ? 0 : -1);
+  }
+  if(read(fds[0], p + amt - 10, 1) != 1 || p[amt - 10] != 'x'){
+    printf(stdout, "read into lazy page failed\n");
+    exit(0);
+  }
+  wait(&i);
+  if(i != 0){
+    printf(stdout, "lazy page lost in fork\n");
+    exit(0);
+  }
+  close(fds[0]);
+  close(fds[1]);
+  sbrk(-amt);
+  printf(stdout, "lazy sbrk test OK\n");
+}
+
+// time fork+exec with a small and a large parent.
+// with copy-on-write fork the parent's size should barely matter.
+void
+forkexecbench(void)
+{
+  char *argv[] = { "echo", 0 };
+  int i, pid, kb, start;
+
+  printf(stdout, "fork+exec bench\n");
+  for(kb = 0; kb <= 4096; kb += 4096){
+    sbrk(kb*1024);
+    start = uptime();
+    for(i = 0; i < 100; i++){
+      pid = fork();
+      if(pid < 0){
+        printf(stdout, "fork failed\n");
+        exit(0);
+      }
+      if(pid == 0){
+        close(1);
+        exec("echo", argv);
+        exit(0);
+      }
+      wait(0);
+    }
+    printf(stdout, "100 fork+exec with %dKB more heap: %d ticks\n",
+           kb, uptime() - start);
+    sbrk(-kb*1024);
+  }
+  printf(stdout, "fork+exec bench OK\n");
+}
+
 void
 sbrktest(void)
 {
@@ -1793,6 +1926,9 @@ main(int argc, char *argv[])
   dirfile();
   iref();
   forktest();
+  cowtest();
+  lazytest();
+  forkexecbench();
   bigdir(); // slow
 
   uio();
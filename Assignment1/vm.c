@@ -51,10 +51,9 @@ walkpgdir(pde_t *pgdir, const void *va, int alloc)
   if(*pde & PTE_P){
     pgtab = (pte_t*)P2V(PTE_ADDR(*pde));
   } else {
-    if(!alloc || (pgtab = (pte_t*)kalloc()) == 0)
+    // Zeroed, so all the PTE_P bits are clear.
+    if(!alloc || (pgtab = (pte_t*)kalloc_zeroed()) == 0)
       return 0;
-    // Make sure all those PTE_P bits are zero.
-    memset(pgtab, 0, PGSIZE);
     // The permissions here are overly generous, but they can
     // be further restricted by the permissions in the page table
     // entries, if necessary.
@@ -130,9 +129,8 @@ setupkvm(void)
   pde_t *pgdir;
   struct kmap *k;
 
-  if((pgdir = (pde_t*)kalloc()) == 0)
+  if((pgdir = (pde_t*)kalloc_zeroed()) == 0)
     return 0;
-  memset(pgdir, 0, PGSIZE);
   if (P2V(PHYSTOP) > (void*)DEVSPACE)
     panic("PHYSTOP too high");
   for(k = kmap; k < &kmap[NELEM(kmap)]; k++)
@@ -192,8 +190,7 @@ inituvm(pde_t *pgdir, char *init, uint sz)
 
   if(sz >= PGSIZE)
     panic("inituvm: more than a page");
-  mem = kalloc();
-  memset(mem, 0, PGSIZE);
+  mem = kalloc_zeroed();
   mappages(pgdir, 0, PGSIZE, V2P(mem), PTE_W|PTE_U);
   memmove(mem, init, sz);
 }
@@ -237,13 +234,12 @@ allocuvm(pde_t *pgdir, uint oldsz, uint newsz)
 
   a = PGROUNDUP(oldsz);
   for(; a < newsz; a += PGSIZE){
-    mem = kalloc();
+    mem = kalloc_zeroed();
     if(mem == 0){
       cprintf("allocuvm out of memory\n");
       deallocuvm(pgdir, newsz, oldsz);
       return 0;
     }
-    memset(mem, 0, PGSIZE);
     if(mappages(pgdir, (char*)a, PGSIZE, V2P(mem), PTE_W|PTE_U) < 0){
       cprintf("allocuvm out of memory (2)\n");
       deallocuvm(pgdir, newsz, oldsz);
@@ -317,37 +313,126 @@ clearpteu(pde_t *pgdir, char *uva)
 }
 
 // Given a parent process's page table, create a copy
-// of it for a child.
+// of it for a child. The pages themselves are shared:
+// writable ones become read-only and PTE_COW in both
+// page tables, and are copied by cowfault() on the first write.
 pde_t*
 copyuvm(pde_t *pgdir, uint sz)
 {
   pde_t *d;
   pte_t *pte;
   uint pa, i, flags;
-  char *mem;
 
   if((d = setupkvm()) == 0)
     return 0;
   for(i = 0; i < sz; i += PGSIZE){
-    if((pte = walkpgdir(pgdir, (void *) i, 0)) == 0)
-      panic("copyuvm: pte should exist");
-    if(!(*pte & PTE_P))
-      panic("copyuvm: page not present");
+    // skip heap pages that were never touched
+    if((pte = walkpgdir(pgdir, (void *) i, 0)) == 0 || !(*pte & PTE_P))
+      continue;
+    if(*pte & PTE_W)
+      *pte = (*pte & ~PTE_W) | PTE_COW;
     pa = PTE_ADDR(*pte);
     flags = PTE_FLAGS(*pte);
-    if((mem = kalloc()) == 0)
-      goto bad;
-    memmove(mem, (char*)P2V(pa), PGSIZE);
-    if(mappages(d, (void*)i, PGSIZE, V2P(mem), flags) < 0)
+    if(mappages(d, (void*)i, PGSIZE, pa, flags) < 0)
       goto bad;
+    krefinc(P2V(pa));
   }
+  if(proc && pgdir == proc->pgdir)
+    lcr3(V2P(pgdir));  // drop stale writable TLB entries
   return d;
 
 bad:
+  if(proc && pgdir == proc->pgdir)
+    lcr3(V2P(pgdir));
   freevm(d);
   return 0;
 }
 
+// Map a zeroed page at va, in heap that growproc() reserved
+// without allocating. The caller checks that va is below sz.
+// Returns -1 if va is already mapped or memory is exhausted.
+int
+lazyfault(pde_t *pgdir, uint va)
+{
+  pte_t *pte;
+  char *mem;
+
+  va = PGROUNDDOWN(va);
+  if((pte = walkpgdir(pgdir, (char*)va, 0)) != 0 && (*pte & PTE_P))
+    return -1;
+  if((mem = kalloc_zeroed()) == 0)
+    return -1;
+  if(mappages(pgdir, (char*)va, PGSIZE, V2P(mem), PTE_W|PTE_U) < 0){
+    kfree(mem);
+    return -1;
+  }
+  return 0;
+}
+
+// Map the lazily allocated pages in [va, va+n), so that a
+// system call can use a user buffer without faulting on it,
+// and fail cleanly if memory is exhausted.
+int
+uvmpopulate(pde_t *pgdir, uint va, uint n)
+{
+  pte_t *pte;
+  uint a;
+
+  for(a = PGROUNDDOWN(va); a < va + n; a += PGSIZE)
+    if(((pte = walkpgdir(pgdir, (char*)a, 0)) == 0 || !(*pte & PTE_P)) &&
+       lazyfault(pgdir, a) < 0)
+      return -1;
+  return 0;
+}
+
+// Handle a write fault at va on a copy-on-write page: give
+// the process its own copy of the page, or if nobody else
+// shares it any more, just make it writable again.
+// Returns -1 if va is not copy-on-write or memory is exhausted.
+int
+cowfault(pde_t *pgdir, uint va)
+{
+  pte_t *pte;
+  uint pa, flags;
+  char *mem;
+
+  if(va >= KERNBASE || (pte = walkpgdir(pgdir, (char*)va, 0)) == 0)
+    return -1;
+  if((*pte & (PTE_P|PTE_COW)) != (PTE_P|PTE_COW))
+    return -1;
+  pa = PTE_ADDR(*pte);
+  flags = (PTE_FLAGS(*pte) & ~PTE_COW) | PTE_W;
+  if(krefcount(P2V(pa)) > 1){
+    if((mem = kalloc()) == 0)
+      return -1;
+    memmove(mem, P2V(pa), PGSIZE);
+    kfree(P2V(pa));
+    pa = V2P(mem);
+  }
+  *pte = pa | flags;
+  lcr3(V2P(pgdir));
+  return 0;
+}
+
+// Make the user pages in [va, va+n) present and writable, so
+// that a system call can write a user buffer without faulting:
+// map lazily allocated pages and copy copy-on-write ones now.
+// Returns -1 if memory is exhausted.
+int
+uvmwritable(pde_t *pgdir, uint va, uint n)
+{
+  pte_t *pte;
+  uint a;
+
+  if(uvmpopulate(pgdir, va, n) < 0)
+    return -1;
+  for(a = PGROUNDDOWN(va); a < va + n; a += PGSIZE)
+    if((pte = walkpgdir(pgdir, (char*)a, 0)) != 0 && (*pte & PTE_COW) &&
+       cowfault(pgdir, a) < 0)
+      return -1;
+  return 0;
+}
+
 //PAGEBREAK!
 // Map user virtual address to kernel address.
 char*
@@ -144,6 +144,37 @@ lcr3(uint val)
   asm volatile("movl %0,%%cr3" : : "r" (val));
 }
 
+// Index of the lowest set bit in a non-zero word.
+static inline uint
+bsf(uint val)
+{
+  uint r;
+  asm("bsfl %1,%0" : "=r" (r) : "rm" (val));
+  return r;
+}
+
+static inline uint64
+rdtsc(void)
+{
+  uint64 val;
+  asm volatile("rdtsc" : "=A" (val));
+  return val;
+}
+
+// 64-by-32-bit unsigned division, which gcc would otherwise
+// turn into a call to libgcc's __udivdi3.
+static inline uint64
+div64(uint64 n, uint d)
+{
+  uint hi, lo, rem;
+
+  hi = n >> 32;
+  rem = hi % d;
+  hi /= d;
+  asm("divl %4" : "=a" (lo), "=d" (rem) : "a" ((uint)n), "d" (rem), "rm" (d));
+  return ((uint64)hi << 32) | lo;
+}
+
 //PAGEBREAK: 36
 // Layout of the trap frame built on the stack by the
 // hardware and by trapasm.S, and passed to trap().
@@ -8,6 +8,7 @@
 #include "memlayout.h"
 #include "mmu.h"
 #include "spinlock.h"
+#include "proc.h"
 
 void freerange(void *vstart, void *vend);
 extern char end[]; // first address after kernel loaded from ELF file
@@ -16,10 +17,29 @@ struct run {
   struct run *next;
 };
 
+#define MAGSIZE 32  // max pages in a per-CPU magazine
+#define MAGBATCH 16 // pages moved to or from kmem.freelist at once
+#define ZPOOLSIZE 64 // max pages in the pre-zeroed pool
+
+// A per-CPU cache of free pages. kalloc() and kfree() work on the
+// local magazine and only take kmem.lock to move MAGBATCH pages
+// between it and the global list. Up to NCPU*MAGSIZE free pages
+// can be held in magazines, so when everything else is empty
+// kalloc() takes pages from other CPUs' magazines; each magazine
+// has a lock for that, which only its own CPU takes otherwise.
+struct magazine {
+  struct spinlock lock;  // before kmem.lock
+  struct run *pages;
+  int n;
+} __attribute__((aligned(64)));
+
 struct {
   struct spinlock lock;
   int use_lock;
   struct run *freelist;
+  struct magazine mag[NCPU];
+  struct run *zeroed;   // pages zeroed by idle CPUs, see kzeroidle()
+  int nzeroed;
 } kmem;
 
 // Initialization happens in two phases.
@@ -30,7 +50,11 @@ struct {
 void
 kinit1(void *vstart, void *vend)
 {
+  struct magazine *m;
+
   initlock(&kmem.lock, "kmem");
+  for(m = kmem.mag; m < kmem.mag+NCPU; m++)
+    initlock(&m->lock, "magazine");
   kmem.use_lock = 0;
   freerange(vstart, vend);
 }
@@ -51,6 +75,47 @@ freerange(void *vstart, void *vend)
     kfree(p);
 }
 
+// Take a page from the pre-zeroed pool, clearing the link
+// that kept it there. Returns 0 if the pool is empty.
+static struct run*
+zpop(void)
+{
+  struct run *r;
+
+  if(kmem.use_lock)
+    acquire(&kmem.lock);
+  r = kmem.zeroed;
+  if(r){
+    kmem.zeroed = r->next;
+    kmem.nzeroed--;
+    r->next = 0;
+  }
+  if(kmem.use_lock)
+    release(&kmem.lock);
+  return r;
+}
+
+// Take a page from any CPU's magazine. Used by kalloc() when
+// its own magazine and kmem.freelist are empty, rather than
+// failing with pages still free on other CPUs.
+static struct run*
+ksteal(void)
+{
+  struct magazine *m;
+  struct run *r;
+
+  r = 0;
+  for(m = kmem.mag; m < kmem.mag+NCPU && r == 0; m++){
+    acquire(&m->lock);
+    if((r = m->pages) != 0){
+      m->pages = r->next;
+      m->n--;
+    }
+    release(&m->lock);
+  }
+  return r;
+}
+
 //PAGEBREAK: 21
 // Free the page of physical memory pointed at by v,
 // which normally should have been returned by a
@@ -59,21 +124,44 @@ freerange(void *vstart, void *vend)
 void
 kfree(char *v)
 {
-  struct run *r;
+  struct run *r, *x;
+  struct magazine *m;
+  int i;
 
   if((uint)v % PGSIZE || v < end || V2P(v) >= PHYSTOP)
     panic("kfree");
 
+#ifndef RELEASE
   // Fill with junk to catch dangling refs.
   memset(v, 1, PGSIZE);
+#endif
 
-  if(kmem.use_lock)
-    acquire(&kmem.lock);
   r = (struct run*)v;
-  r->next = kmem.freelist;
-  kmem.freelist = r;
-  if(kmem.use_lock)
+  if(!kmem.use_lock){
+    r->next = kmem.freelist;
+    kmem.freelist = r;
+    return;
+  }
+
+  pushcli();
+  m = &kmem.mag[cpu - cpus];
+  acquire(&m->lock);
+  if(m->n == MAGSIZE){
+    acquire(&kmem.lock);
+    for(i = 0; i < MAGBATCH; i++){
+      x = m->pages;
+      m->pages = x->next;
+      x->next = kmem.freelist;
+      kmem.freelist = x;
+    }
+    m->n -= MAGBATCH;
     release(&kmem.lock);
+  }
+  r->next = m->pages;
+  m->pages = r;
+  m->n++;
+  release(&m->lock);
+  popcli();
 }
 
 // Allocate one 4096-byte page of physical memory.
@@ -83,14 +171,70 @@ char*
 kalloc(void)
 {
   struct run *r;
+  struct magazine *m;
 
-  if(kmem.use_lock)
+  if(!kmem.use_lock){
+    r = kmem.freelist;
+    if(r)
+      kmem.freelist = r->next;
+    return (char*)r;
+  }
+
+  pushcli();
+  m = &kmem.mag[cpu - cpus];
+  acquire(&m->lock);
+  if(m->n == 0){
     acquire(&kmem.lock);
-  r = kmem.freelist;
-  if(r)
-    kmem.freelist = r->next;
-  if(kmem.use_lock)
+    while(m->n < MAGBATCH && (r = kmem.freelist) != 0){
+      kmem.freelist = r->next;
+      r->next = m->pages;
+      m->pages = r;
+      m->n++;
+    }
     release(&kmem.lock);
+  }
+  r = m->pages;
+  if(r){
+    m->pages = r->next;
+    m->n--;
+  }
+  release(&m->lock);
+  popcli();
+  if(r == 0)
+    r = ksteal();
+  if(r == 0)
+    r = zpop();
   return (char*)r;
 }
 
+// Allocate one 4096-byte page of zeroed physical memory,
+// from the pre-zeroed pool if it is not empty.
+// Returns 0 if the memory cannot be allocated.
+char*
+kalloc_zeroed(void)
+{
+  char *v;
+
+  if((v = (char*)zpop()) == 0 && (v = kalloc()) != 0)
+    memset(v, 0, PGSIZE);
+  return v;
+}
+
+// Zero one free page for the pre-zeroed pool unless it is full.
+// Called by the scheduler when this CPU has nothing to run,
+// so that kalloc_zeroed() callers need not zero pages themselves.
+void
+kzeroidle(void)
+{
+  struct run *r;
+
+  if(kmem.nzeroed >= ZPOOLSIZE || (r = (struct run*)kalloc()) == 0)
+    return;
+  memset(r, 0, PGSIZE);
+  acquire(&kmem.lock);
+  r->next = kmem.zeroed;
+  kmem.zeroed = r;
+  kmem.nzeroed++;
+  release(&kmem.lock);
+}
+
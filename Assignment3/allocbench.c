@@ -0,0 +1,79 @@
+// Page allocator benchmark for the per-CPU kalloc magazines.
+// Runs nworkers processes in parallel, each of which forks children
+// that grow by NPAGES pages and exit, for a fixed number of ticks.
+// Each fork allocates a kernel stack, page tables and a copy of the
+// worker's pages, so the rate is dominated by kalloc() and kfree().
+// Compare the reported rate across runs with different CPUS, e.g.
+//   make qemu CPUS=1   ...   make qemu CPUS=8
+// and run "allocbench 8 300" in each.
+
+#include "types.h"
+#include "user.h"
+
+#define HZ 100     // approximate timer ticks per second under qemu
+#define NPAGES 8   // pages each child adds with sbrk
+#define PGSIZE 4096
+
+// Fork children until deadline; return the number that ran.
+int
+churn(int deadline)
+{
+  int n, pid;
+
+  n = 0;
+  while(uptime() < deadline){
+    if((pid = fork()) < 0)
+      break;
+    if(pid == 0){
+      sbrk(NPAGES * PGSIZE);
+      exit();
+    }
+    wait();
+    n++;
+  }
+  return n;
+}
+
+int
+main(int argc, char *argv[])
+{
+  int nworkers, nticks, start, deadline, i, n, forks, elapsed;
+  int fds[2];
+
+  nworkers = argc > 1 ? atoi(argv[1]) : 4;
+  nticks = argc > 2 ? atoi(argv[2]) : 300;
+  if(nworkers < 1 || nticks < 1){
+    printf(2, "usage: allocbench [nworkers] [ticks]\n");
+    exit();
+  }
+  if(pipe(fds) < 0){
+    printf(2, "allocbench: pipe failed\n");
+    exit();
+  }
+
+  start = uptime();
+  deadline = start + nticks;
+  for(i = 0; i < nworkers; i++){
+    if(fork() == 0){
+      close(fds[0]);
+      n = churn(deadline);
+      write(fds[1], &n, sizeof(n));
+      exit();
+    }
+  }
+  close(fds[1]);
+
+  forks = 0;
+  while(read(fds[0], &n, sizeof(n)) == sizeof(n))
+    forks += n;
+  for(i = 0; i < nworkers; i++)
+    wait();
+  elapsed = uptime() - start;
+  if(elapsed < 1)
+    elapsed = 1;
+
+  printf(1, "allocbench: %d workers, %d ticks, %d forks, %d forks/sec, "
+         "%d sbrk pages/sec\n", nworkers, elapsed, forks,
+         forks * HZ / elapsed, forks * NPAGES * HZ / elapsed);
+  exit();
+}
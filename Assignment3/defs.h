@@ -67,9 +67,11 @@ void            ioapicinit(void);
 
 // kalloc.c
 char*           kalloc(void);
+char*           kalloc_zeroed(void);
 void            kfree(char*);
 void            kinit1(void*, void*);
 void            kinit2(void*, void*);
+void            kzeroidle(void);
 int 			pages_allocated_in_system;
 int 			total_pages_in_system;
 
@@ -359,16 +359,19 @@ void
 scheduler(void)
 {
   struct proc *p;
+  int idle;
 
   for(;;){
     // Enable interrupts on this processor.
     sti();
 
     // Loop over process table looking for process to run.
+    idle = 1;
     acquire(&ptable.lock);
     for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
       if(p->state != RUNNABLE)
         continue;
+      idle = 0;
 
       // Switch to chosen process.  It is the process's job
       // to release ptable.lock and then reacquire it
@@ -385,6 +388,9 @@ scheduler(void)
     }
     release(&ptable.lock);
 
+    // Nothing to run: zero a page for kalloc_zeroed() meanwhile.
+    if(idle)
+      kzeroidle();
   }
 }
 
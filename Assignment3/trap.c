@@ -100,7 +100,6 @@ trap(struct trapframe *tf)
       pages_allocated_in_system++;
       if(SELECTION == LIFO) push_to_lifo(cr2);
       else if(SELECTION == SCFIFO) enqueue_scfifo(cr2);
-      memset(page_mem, 0, PGSIZE);
       if(readFromSwapFile(proc, page_mem, offset, PGSIZE) == -1) panic("could not read from swap file");
 
       // prepare the PTE
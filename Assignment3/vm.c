@@ -52,11 +52,10 @@ walkpgdir(pde_t *pgdir, const void *va, int alloc)
   if(*pde & PTE_P){
     pgtab = (pte_t*)p2v(PTE_ADDR(*pde));
   } else {
-    if(!alloc || (pgtab = (pte_t*)kalloc()) == 0)
+    // Zeroed, so all the PTE_P bits are clear.
+    if(!alloc || (pgtab = (pte_t*)kalloc_zeroed()) == 0)
       return 0;
     pages_allocated_in_system++;
-    // Make sure all those PTE_P bits are zero.
-    memset(pgtab, 0, PGSIZE);
     // The permissions here are overly generous, but they can
     // be further restricted by the permissions in the page table
     // entries, if necessary.
@@ -132,10 +131,9 @@ setupkvm(void)
   pde_t *pgdir;
   struct kmap *k;
 
-  if((pgdir = (pde_t*)kalloc()) == 0)
+  if((pgdir = (pde_t*)kalloc_zeroed()) == 0)
     return 0;
   pages_allocated_in_system++;
-  memset(pgdir, 0, PGSIZE);
   if (p2v(PHYSTOP) > (void*)DEVSPACE)
     panic("PHYSTOP too high");
   for(k = kmap; k < &kmap[NELEM(kmap)]; k++)
@@ -187,9 +185,8 @@ inituvm(pde_t *pgdir, char *init, uint sz)
 
   if(sz >= PGSIZE)
     panic("inituvm: more than a page");
-  mem = kalloc();
+  mem = kalloc_zeroed();
   pages_allocated_in_system++;
-  memset(mem, 0, PGSIZE);
   mappages(pgdir, 0, PGSIZE, v2p(mem), PTE_W|PTE_U);
   memmove(mem, init, sz);
 }
@@ -237,14 +234,13 @@ allocuvm(pde_t *pgdir, uint oldsz, uint newsz)
       // max number of pages in ram reached. drop a page to disk
       page_out_appropriate_page();
     }
-    mem = kalloc();
+    mem = kalloc_zeroed();
     if(mem == 0){
       cprintf("allocuvm out of memory\n");
       deallocuvm(pgdir, newsz, oldsz);
       return 0;
     }
     pages_allocated_in_system++;
-    memset(mem, 0, PGSIZE);
     if(strcmp(proc->name, "init") && strcmp(proc->name, "sh")) {    // regular proccess
         if(SELECTION == LIFO) push_to_lifo(a);
         else if(SELECTION == SCFIFO) enqueue_scfifo(a);